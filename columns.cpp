@@ -0,0 +1,540 @@
+#include "columns.h"
+#include "kernels.h"
+#include "native.h"
+#include "numparse.h"
+#include "operators.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <ostream>
+#include <string_view>
+
+namespace {
+
+const char ColumnMagic[4] = {'N', 'C', 'O', 'L'};
+const std::uint32_t ColumnVersion = 1;
+
+void putU32(std::ofstream &out, std::uint32_t value)
+{
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; ++i)
+        bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+    out.write(reinterpret_cast<const char *>(bytes), 4);
+}
+
+void putU64(std::ofstream &out, std::uint64_t value)
+{
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; ++i)
+        bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+    out.write(reinterpret_cast<const char *>(bytes), 8);
+}
+
+bool getU32(std::ifstream &in, std::uint32_t &value)
+{
+    unsigned char bytes[4];
+    if (!in.read(reinterpret_cast<char *>(bytes), 4))
+        return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i)
+        value |= static_cast<std::uint32_t>(bytes[i]) << (8 * i);
+    return true;
+}
+
+bool getU64(std::ifstream &in, std::uint64_t &value)
+{
+    unsigned char bytes[8];
+    if (!in.read(reinterpret_cast<char *>(bytes), 8))
+        return false;
+    value = 0;
+    for (int i = 0; i < 8; ++i)
+        value |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+    return true;
+}
+
+std::string_view trim(std::string_view text)
+{
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+        return std::string_view();
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+} // namespace
+
+void ColumnTable::clear()
+{
+    names.clear();
+    columns.clear();
+    rows = 0;
+}
+
+void ColumnTable::addColumn(const std::string &name, std::vector<double> values)
+{
+    if (names.empty())
+        rows = values.size();
+    names.push_back(name);
+    columns.push_back(std::move(values));
+}
+
+int ColumnTable::findColumn(const std::string &name) const
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+}
+
+bool ColumnTable::load(const std::string &fileName, std::string &error)
+{
+    std::string ext;
+    size_t dot = fileName.find_last_of('.');
+    if (dot != std::string::npos)
+        ext = fileName.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return ext == ".col" ? loadBinary(fileName, error) : loadCsv(fileName, error);
+}
+
+void ColumnTable::setColumns(const std::vector<std::string> &columnNames)
+{
+    names = columnNames;
+    columns.assign(names.size(), std::vector<double>());
+    rows = 0;
+}
+
+void ColumnTable::appendRow(const std::vector<double> &values)
+{
+    for (size_t i = 0; i < columns.size(); ++i)
+        columns[i].push_back(values[i]);
+    ++rows;
+}
+
+void ColumnTable::clearRows()
+{
+    for (auto &column : columns)
+        column.clear();
+    rows = 0;
+}
+
+bool ColumnTable::loadCsv(const std::string &fileName, std::string &error)
+{
+    clear();
+
+    std::ifstream in(fileName);
+    if (!in.is_open()) {
+        error = "ERROR: Не удалось открыть таблицу операндов: " + fileName;
+        return false;
+    }
+
+    CsvReader reader(in);
+    std::vector<std::string> header;
+    if (!reader.readHeader(header, error))
+        return false;
+    setColumns(header);
+
+    std::vector<double> values;
+    while (reader.readRow(values, error))
+        appendRow(values);
+    return error.empty();
+}
+
+bool ColumnTable::loadBinary(const std::string &fileName, std::string &error)
+{
+    clear();
+
+    std::ifstream in(fileName, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        error = "ERROR: Не удалось открыть таблицу операндов: " + fileName;
+        return false;
+    }
+
+    char magic[4];
+    std::uint32_t version = 0;
+    std::uint32_t count = 0;
+    std::uint64_t rowCount = 0;
+    if (!in.read(magic, 4) || std::memcmp(magic, ColumnMagic, 4) != 0) {
+        error = "ERROR: Файл не является таблицей столбцов: " + fileName;
+        return false;
+    }
+    if (!getU32(in, version) || version != ColumnVersion) {
+        error = "ERROR: Неподдерживаемая версия таблицы столбцов: " + std::to_string(version);
+        return false;
+    }
+    if (!getU32(in, count) || !getU64(in, rowCount)) {
+        error = "ERROR: Повреждённый заголовок таблицы столбцов";
+        return false;
+    }
+
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::uint32_t length = 0;
+        if (!getU32(in, length) || length == 0 || length > 4096) {
+            error = "ERROR: Повреждённое имя столбца";
+            return false;
+        }
+        std::string name(length, '\0');
+        if (!in.read(&name[0], length)) {
+            error = "ERROR: Повреждённое имя столбца";
+            return false;
+        }
+        if (std::find(names.begin(), names.end(), name) != names.end()) {
+            error = "ERROR: Повторяющееся имя столбца: '" + name + "'";
+            clear();
+            return false;
+        }
+        names.push_back(name);
+    }
+
+    // Число строк из заголовка не должно превышать данные файла: иначе размер буфера
+    // переполняется или выделение памяти завершает программу исключением
+    const std::streamoff dataStart = in.tellg();
+    in.seekg(0, std::ios::end);
+    const std::streamoff fileEnd = in.tellg();
+    in.seekg(dataStart);
+    const std::uint64_t available = dataStart >= 0 && fileEnd >= dataStart
+                                        ? static_cast<std::uint64_t>(fileEnd - dataStart)
+                                        : 0;
+    const std::uint64_t rowLimit = available / sizeof(std::uint64_t)
+                                   / std::max<std::uint64_t>(count, 1);
+    if (!in || rowCount > rowLimit) {
+        error = "ERROR: Таблица столбцов обрезана: " + fileName;
+        clear();
+        return false;
+    }
+
+    rows = static_cast<size_t>(rowCount);
+    columns.resize(names.size());
+    std::vector<unsigned char> bytes(rows * sizeof(std::uint64_t));
+    for (auto &column : columns) {
+        if (!in.read(reinterpret_cast<char *>(bytes.data()), bytes.size())) {
+            error = "ERROR: Таблица столбцов обрезана: " + fileName;
+            clear();
+            return false;
+        }
+        column.resize(rows);
+        for (size_t r = 0; r < rows; ++r) {
+            std::uint64_t raw = 0;
+            for (int b = 0; b < 8; ++b)
+                raw |= static_cast<std::uint64_t>(bytes[r * 8 + b]) << (8 * b);
+            std::memcpy(&column[r], &raw, sizeof(double));
+        }
+    }
+    return true;
+}
+
+bool ColumnTable::saveBinary(const std::string &fileName, std::string &error) const
+{
+    std::ofstream out(fileName, std::ios::out | std::ios::binary);
+    if (!out.is_open()) {
+        error = "ERROR: Не удалось создать таблицу столбцов: " + fileName;
+        return false;
+    }
+
+    out.write(ColumnMagic, 4);
+    putU32(out, ColumnVersion);
+    putU32(out, static_cast<std::uint32_t>(names.size()));
+    putU64(out, rows);
+    for (const std::string &name : names) {
+        putU32(out, static_cast<std::uint32_t>(name.size()));
+        out.write(name.data(), name.size());
+    }
+    for (const auto &column : columns) {
+        for (double value : column) {
+            std::uint64_t raw = 0;
+            std::memcpy(&raw, &value, sizeof(double));
+            putU64(out, raw);
+        }
+    }
+
+    if (!out) {
+        error = "ERROR: Ошибка записи таблицы столбцов: " + fileName;
+        return false;
+    }
+    return true;
+}
+
+CsvReader::CsvReader(std::istream &in)
+    : in(in)
+{}
+
+bool CsvReader::readHeader(std::vector<std::string> &names, std::string &error)
+{
+    names.clear();
+    if (!std::getline(in, buffer)) {
+        error = "ERROR: Таблица операндов пуста";
+        return false;
+    }
+    line = 1;
+    if (!buffer.empty() && buffer.back() == '\r')
+        buffer.pop_back();
+
+    separator = buffer.find(';') != std::string::npos    ? ';'
+                : buffer.find('\t') != std::string::npos ? '\t'
+                                                         : ',';
+    std::string_view rest(buffer);
+    while (true) {
+        size_t end = rest.find(separator);
+        std::string name(trim(rest.substr(0, end)));
+        if (name.empty()) {
+            error = "ERROR: Строка 1 - отсутствует имя столбца";
+            return false;
+        }
+        if (std::find(names.begin(), names.end(), name) != names.end()) {
+            error = "ERROR: Строка 1 - повторяющееся имя столбца: '" + name + "'";
+            return false;
+        }
+        names.push_back(name);
+        if (end == std::string_view::npos)
+            break;
+        rest.remove_prefix(end + 1);
+    }
+    columns = names.size();
+    error.clear();
+    return true;
+}
+
+bool CsvReader::readRow(std::vector<double> &values, std::string &error)
+{
+    error.clear();
+    while (std::getline(in, buffer)) {
+        ++line;
+        if (!buffer.empty() && buffer.back() == '\r')
+            buffer.pop_back();
+        if (trim(buffer).empty())
+            continue;
+
+        values.resize(columns);
+        std::string_view rest(buffer);
+        size_t count = 0;
+        while (true) {
+            size_t end = rest.find(separator);
+            std::string_view text = trim(rest.substr(0, end));
+            if (count < columns && !parseNumber(text, values[count])) {
+                error = "ERROR: Строка " + std::to_string(line) + " - некорректное значение: '"
+                        + std::string(text) + "'";
+                return false;
+            }
+            ++count;
+            if (end == std::string_view::npos)
+                break;
+            rest.remove_prefix(end + 1);
+        }
+        if (count != columns) {
+            error = "ERROR: Строка " + std::to_string(line) + " - ожидалось "
+                    + std::to_string(columns) + " значений, найдено " + std::to_string(count);
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+ColumnEvaluator::ColumnEvaluator()
+    : kernels(&bestKernels())
+{}
+
+bool ColumnEvaluator::prepare(const Program &program,
+                              const ColumnTable &table,
+                              const OperandMap &scalars,
+                              std::string &error)
+{
+    this->program = nullptr;
+    sources.assign(program.variableCount(), nullptr);
+    this->scalars.assign(program.variableCount(), 0);
+    rows = table.rowCount();
+
+    if (!program.isWellFormed()) {
+        error = "ERROR: Неверно сформированное RPN выражение";
+        return false;
+    }
+
+    for (size_t slot = 0; slot < program.variableCount(); ++slot) {
+        const std::string &name = program.variableName(slot);
+        int column = table.findColumn(name);
+        if (column >= 0) {
+            sources[slot] = table.column(column);
+            continue;
+        }
+        const double *value = scalars.find(name);
+        if (!value) {
+            error = "ERROR: Неопределённый операнд: " + name;
+            return false;
+        }
+        this->scalars[slot] = *value;
+    }
+
+    this->program = &program;
+    return true;
+}
+
+size_t ColumnEvaluator::evaluate(size_t begin,
+                                 size_t end,
+                                 double *out,
+                                 std::uint8_t *failed,
+                                 std::vector<double> &scratch) const
+{
+    if (native && native->ready())
+        return native->evaluateRows(sources.data(), scalars.data(), begin, end, out, failed);
+
+    // Блоки стека, за ними блоки временных ячеек общих подвыражений
+    const size_t depth = program->stackDepth();
+    if (scratch.size() < program->frameSize() * BlockSize)
+        scratch.resize(program->frameSize() * BlockSize);
+    double *const temps = scratch.data() + depth * BlockSize;
+
+    // Элемент стека указывает либо прямо в столбец таблицы, либо в свой блок scratch
+    std::vector<const double *> stack(depth);
+    size_t failures = 0;
+
+    for (size_t block = begin; block < end; block += BlockSize) {
+        const size_t n = std::min(BlockSize, end - block);
+        double *rowOut = out + (block - begin);
+        std::uint8_t *rowFailed = failed + (block - begin);
+        std::fill(rowFailed, rowFailed + n, 0);
+        size_t top = 0;
+
+        for (const Instruction &ins : program->code()) {
+            double *level = scratch.data() + top * BlockSize;
+            switch (ins.op) {
+            case OpCode::Constant:
+                std::fill(level, level + n, program->constant(ins.arg));
+                stack[top++] = level;
+                break;
+            case OpCode::Variable:
+                if (sources[ins.arg]) {
+                    stack[top++] = sources[ins.arg] + block;
+                } else {
+                    std::fill(level, level + n, scalars[ins.arg]);
+                    stack[top++] = level;
+                }
+                break;
+            case OpCode::Store:
+                std::copy(stack[top - 1], stack[top - 1] + n, temps + ins.arg * BlockSize);
+                break;
+            case OpCode::Load:
+                stack[top++] = temps + ins.arg * BlockSize;
+                break;
+            case OpCode::Add:
+            case OpCode::Subtract:
+            case OpCode::Multiply:
+            case OpCode::Divide: {
+                const double *b = stack[--top];
+                const double *a = stack[top - 1];
+                double *target = scratch.data() + (top - 1) * BlockSize;
+                if (ins.op == OpCode::Add)
+                    kernels->add(a, b, target, n);
+                else if (ins.op == OpCode::Subtract)
+                    kernels->subtract(a, b, target, n);
+                else if (ins.op == OpCode::Multiply)
+                    kernels->multiply(a, b, target, n);
+                else if (kernels->divide(a, b, target, n)) {
+                    for (size_t i = 0; i < n; ++i)
+                        rowFailed[i] |= b[i] == 0;
+                }
+                stack[top - 1] = target;
+                break;
+            }
+            // Унарный минус и операции без ядер - скалярным циклом
+            default: {
+                const bool unary = arity(ins.op) == 1;
+                const double *b = unary ? nullptr : stack[--top];
+                const double *a = stack[top - 1];
+                double *target = scratch.data() + (top - 1) * BlockSize;
+                if (unary) {
+                    for (size_t i = 0; i < n; ++i)
+                        target[i] = applyUnary(ins.op, a[i]);
+                } else {
+                    for (size_t i = 0; i < n; ++i)
+                        target[i] = applyBinary(ins.op, a[i], b[i]);
+                }
+                stack[top - 1] = target;
+                break;
+            }
+            }
+        }
+
+        const double *value = stack[0];
+        for (size_t i = 0; i < n; ++i) {
+            if (rowFailed[i]) {
+                rowOut[i] = std::numeric_limits<double>::quiet_NaN();
+                ++failures;
+            } else {
+                rowOut[i] = value[i];
+            }
+        }
+    }
+    return failures;
+}
+
+void ColumnEvaluator::evaluateAll(ColumnResult &result) const
+{
+    result.values.resize(rows);
+    result.failed.resize(rows);
+    std::vector<double> scratch;
+    result.failures = evaluate(0, rows, result.values.data(), result.failed.data(), scratch);
+}
+
+void ColumnEvaluator::evaluateAll(ColumnResult &result, ThreadPool &pool) const
+{
+    result.values.resize(rows);
+    result.failed.resize(rows);
+
+    const size_t tasks = (rows + TaskRows - 1) / TaskRows;
+    std::vector<std::vector<double>> scratch(pool.threadCount());
+    std::vector<size_t> failures(tasks);
+
+    pool.run(tasks, [&](size_t index, size_t worker) {
+        size_t begin = index * TaskRows;
+        size_t end = std::min(rows, begin + TaskRows);
+        failures[index] = evaluate(begin,
+                                   end,
+                                   result.values.data() + begin,
+                                   result.failed.data() + begin,
+                                   scratch[worker]);
+    });
+
+    result.failures = 0;
+    for (size_t count : failures)
+        result.failures += count;
+}
+
+void writeResultRows(std::ostream &out,
+                     const double *values,
+                     const std::uint8_t *failed,
+                     size_t count)
+{
+    char buffer[64];
+    for (size_t i = 0; i < count; ++i) {
+        if (failed[i]) {
+            out << "ERROR\n";
+            continue;
+        }
+        // Кратчайшая запись, однозначно восстанавливающая double
+        auto res = std::to_chars(buffer, buffer + sizeof(buffer), values[i]);
+        out.write(buffer, res.ptr - buffer);
+        out.put('\n');
+    }
+}
+
+bool saveResultCsv(const std::string &fileName, const ColumnResult &result, std::string &error)
+{
+    std::ofstream out(fileName);
+    if (!out.is_open()) {
+        error = "ERROR: Не удалось создать файл результата: " + fileName;
+        return false;
+    }
+
+    out << "result\n";
+    writeResultRows(out, result.values.data(), result.failed.data(), result.values.size());
+
+    if (!out) {
+        error = "ERROR: Ошибка записи файла результата: " + fileName;
+        return false;
+    }
+    return true;
+}
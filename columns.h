@@ -0,0 +1,120 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include "program.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct KernelSet;
+class NativeProgram;
+class ThreadPool;
+
+// Таблица операндов: каждый операнд - столбец из rowCount() значений.
+// Формат CSV: первая строка - имена, разделитель ';' или табуляция
+// (',' допустим как разделитель, только если нет ни ';', ни табуляции).
+// Бинарный формат .col: заголовок, имена столбцов и значения little-endian по столбцам
+class ColumnTable
+{
+public:
+    bool load(const std::string &fileName, std::string &error);
+    bool loadCsv(const std::string &fileName, std::string &error);
+    bool loadBinary(const std::string &fileName, std::string &error);
+    bool saveBinary(const std::string &fileName, std::string &error) const;
+
+    void clear();
+    void addColumn(const std::string &name, std::vector<double> values);
+    // Пустые столбцы с заданными именами; строки добавляются appendRow
+    void setColumns(const std::vector<std::string> &columnNames);
+    void appendRow(const std::vector<double> &values);
+    // Удаляет строки, сохраняя имена и выделенную память
+    void clearRows();
+
+    size_t rowCount() const { return rows; }
+    size_t columnCount() const { return names.size(); }
+    const std::string &columnName(size_t index) const { return names[index]; }
+    const double *column(size_t index) const { return columns[index].data(); }
+    int findColumn(const std::string &name) const;
+
+private:
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+    size_t rows = 0;
+};
+
+// Построчное чтение CSV-таблицы из любого потока (файл, stdin).
+// Разделитель определяется по строке заголовка
+class CsvReader
+{
+public:
+    explicit CsvReader(std::istream &in);
+
+    bool readHeader(std::vector<std::string> &names, std::string &error);
+    // false - данные закончились или ошибка (тогда error не пуст)
+    bool readRow(std::vector<double> &values, std::string &error);
+    size_t lineNumber() const { return line; }
+
+private:
+    std::istream &in;
+    std::string buffer;
+    char separator = ';';
+    size_t columns = 0;
+    size_t line = 0;
+};
+
+// Результат по строкам: failed[i] != 0 - в строке i произошло деление на ноль
+struct ColumnResult
+{
+    std::vector<double> values;
+    std::vector<std::uint8_t> failed;
+    size_t failures = 0;
+};
+
+// Вычисляет программу сразу по блокам строк, а не по одной строке
+class ColumnEvaluator
+{
+public:
+    static constexpr size_t BlockSize = 1024;
+    // Единица работы для пула потоков: 64 блока по BlockSize строк
+    static constexpr size_t TaskRows = 64 * BlockSize;
+
+    ColumnEvaluator();
+
+    // Операнды берутся из столбцов таблицы, недостающие - из scalars
+    bool prepare(const Program &program,
+                 const ColumnTable &table,
+                 const OperandMap &scalars,
+                 std::string &error);
+
+    void setKernels(const KernelSet &kernels) { this->kernels = &kernels; }
+    // Собранный машинный код той же программы; nullptr - интерпретатор с ядрами
+    void setNative(const NativeProgram *native) { this->native = native; }
+    size_t rowCount() const { return rows; }
+
+    // Вычисляет строки [begin, end); scratch - рабочая память вызывающего потока
+    size_t evaluate(size_t begin,
+                    size_t end,
+                    double *out,
+                    std::uint8_t *failed,
+                    std::vector<double> &scratch) const;
+    void evaluateAll(ColumnResult &result) const;
+    void evaluateAll(ColumnResult &result, ThreadPool &pool) const;
+
+private:
+    const Program *program = nullptr;
+    const KernelSet *kernels;
+    const NativeProgram *native = nullptr;
+    std::vector<const double *> sources; // столбец для слота или nullptr
+    std::vector<double> scalars;
+    size_t rows = 0;
+};
+
+// Столбец результата в CSV: по строке на значение, "ERROR" для деления на ноль
+void writeResultRows(std::ostream &out,
+                     const double *values,
+                     const std::uint8_t *failed,
+                     size_t count);
+bool saveResultCsv(const std::string &fileName, const ColumnResult &result, std::string &error);
+
+#endif // COLUMNS_H
@@ -0,0 +1,189 @@
+#include "compiledfile.h"
+#include <cstring>
+
+namespace {
+
+const char Magic[4] = {'N', 'G', 'R', 'B'};
+
+void putU32(std::string &out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+void putF64(std::string &out, double value)
+{
+    std::uint64_t raw = 0;
+    std::memcpy(&raw, &value, sizeof(double));
+    for (int i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>(raw >> (8 * i)));
+}
+
+void putString(std::string &out, const std::string &text)
+{
+    putU32(out, static_cast<std::uint32_t>(text.size()));
+    out += text;
+}
+
+// Последовательное чтение с проверкой границ: повреждённый файл
+// приводит к ошибке, а не к выходу за пределы отображения
+class Reader
+{
+public:
+    explicit Reader(std::string_view bytes)
+        : bytes(bytes)
+    {}
+
+    bool u8(std::uint8_t &value)
+    {
+        if (bytes.size() < 1)
+            return false;
+        value = static_cast<std::uint8_t>(bytes[0]);
+        bytes.remove_prefix(1);
+        return true;
+    }
+
+    bool u32(std::uint32_t &value)
+    {
+        if (bytes.size() < 4)
+            return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i)
+            value |= static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+        bytes.remove_prefix(4);
+        return true;
+    }
+
+    bool f64(double &value)
+    {
+        if (bytes.size() < 8)
+            return false;
+        std::uint64_t raw = 0;
+        for (int i = 0; i < 8; ++i)
+            raw |= static_cast<std::uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+        std::memcpy(&value, &raw, sizeof(double));
+        bytes.remove_prefix(8);
+        return true;
+    }
+
+    bool string(std::string &value)
+    {
+        std::uint32_t length = 0;
+        if (!u32(length) || bytes.size() < length)
+            return false;
+        value.assign(bytes.data(), length);
+        bytes.remove_prefix(length);
+        return true;
+    }
+
+    // Число элементов не может превышать оставшиеся байты
+    bool count(std::uint32_t &value, size_t minItemSize)
+    {
+        return u32(value) && static_cast<size_t>(value) * minItemSize <= bytes.size();
+    }
+
+    bool atEnd() const { return bytes.empty(); }
+
+private:
+    std::string_view bytes;
+};
+
+} // namespace
+
+bool CompiledFile::isCompiled(std::string_view bytes)
+{
+    return bytes.size() >= sizeof(Magic) && std::memcmp(bytes.data(), Magic, sizeof(Magic)) == 0;
+}
+
+std::string CompiledFile::serialize() const
+{
+    std::string out(Magic, sizeof(Magic));
+    putU32(out, Version);
+    putString(out, expression);
+    putString(out, rpn);
+
+    putU32(out, static_cast<std::uint32_t>(program.code().size()));
+    for (const Instruction &ins : program.code()) {
+        out.push_back(static_cast<char>(ins.op));
+        putU32(out, ins.arg);
+    }
+
+    putU32(out, static_cast<std::uint32_t>(program.constantCount()));
+    for (size_t i = 0; i < program.constantCount(); ++i)
+        putF64(out, program.constant(static_cast<std::uint32_t>(i)));
+
+    putU32(out, static_cast<std::uint32_t>(program.variableCount()));
+    for (size_t i = 0; i < program.variableCount(); ++i)
+        putString(out, program.variableName(i));
+
+    putU32(out, static_cast<std::uint32_t>(operands.size()));
+    for (size_t i = 0; i < operands.size(); ++i) {
+        putString(out, operands.name(i));
+        putF64(out, operands.value(i));
+    }
+    return out;
+}
+
+bool CompiledFile::deserialize(std::string_view bytes, std::string &error)
+{
+    if (!isCompiled(bytes)) {
+        error = "ERROR: Файл не является скомпилированным выражением";
+        return false;
+    }
+    Reader in(bytes.substr(sizeof(Magic)));
+
+    std::uint32_t version = 0;
+    if (!in.u32(version) || version < OldestVersion || version > Version) {
+        error = "ERROR: Неподдерживаемая версия бинарного файла: " + std::to_string(version);
+        return false;
+    }
+
+    error = "ERROR: Бинарный файл повреждён";
+    if (!in.string(expression) || !in.string(rpn))
+        return false;
+
+    std::uint32_t count = 0;
+    if (!in.count(count, 5))
+        return false;
+    std::vector<Instruction> code(count);
+    for (Instruction &ins : code) {
+        std::uint8_t op = 0;
+        if (!in.u8(op) || !in.u32(ins.arg))
+            return false;
+        ins.op = static_cast<OpCode>(op);
+    }
+
+    if (!in.count(count, 8))
+        return false;
+    std::vector<double> constants(count);
+    for (double &value : constants) {
+        if (!in.f64(value))
+            return false;
+    }
+
+    if (!in.count(count, 4))
+        return false;
+    std::vector<std::string> variables(count);
+    for (std::string &name : variables) {
+        if (!in.string(name))
+            return false;
+    }
+
+    if (!in.count(count, 12))
+        return false;
+    operands.clear();
+    operands.reserve(count);
+    std::string name;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        double value = 0;
+        if (!in.string(name) || !in.f64(value))
+            return false;
+        operands.set(name, value);
+    }
+
+    if (!in.atEnd() || !program.assign(std::move(code), std::move(constants), std::move(variables)))
+        return false;
+
+    error.clear();
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef COMPILEDFILE_H
+#define COMPILEDFILE_H
+
+#include "program.h"
+#include <string>
+#include <string_view>
+
+// Файл .bin версии 5: уже проверенное и скомпилированное выражение.
+// Все числа little-endian, строки - длина u32 и байты без завершающего нуля:
+//   "NGRB", u32 версия
+//   строка выражения, строка ОПЗ (только для журнала)
+//   u32 N, N x (u8 код операции, u32 аргумент)
+//   u32 N, N x f64 - таблица констант
+//   u32 N, N x строка - имена слотов операндов
+//   u32 N, N x (строка имени, f64 значение) - операнды из файла
+// Версия 3 добавила команду Negate, версия 4 - Store и Load общих подвыражений,
+// версия 5 - операции из таблицы operators.cpp; файлы прежних версий читаются без изменений.
+// Файлы без сигнатуры считаются прежним текстовым форматом
+struct CompiledFile
+{
+    static constexpr std::uint32_t Version = 5;
+    static constexpr std::uint32_t OldestVersion = 2;
+
+    std::string expression;
+    std::string rpn;
+    Program program;
+    OperandMap operands;
+
+    static bool isCompiled(std::string_view bytes);
+
+    std::string serialize() const;
+    bool deserialize(std::string_view bytes, std::string &error);
+};
+
+#endif // COMPILEDFILE_H
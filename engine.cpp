@@ -0,0 +1,1380 @@
+#include "engine.h"
+#include "compiledfile.h"
+#include "evalcache.h"
+#include "mappedfile.h"
+#include "metrics.h"
+#include "numparse.h"
+#include "operators.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr std::string_view Openers = "([{";
+constexpr std::string_view Closers = ")]}";
+
+// Вид предыдущего токена выражения в convertToRPN
+enum class Previous { Start, Open, Close, Separator, Operator, Operand };
+
+// Столбец с 1 в символах UTF-8: продолжения многобайтных символов не считаются
+size_t columnOf(std::string_view text, size_t offset)
+{
+    size_t column = 1;
+    for (size_t i = 0; i < offset && i < text.size(); ++i)
+        column += (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80;
+    return column;
+}
+
+// Первое вхождение name в выражение отдельным токеном; 0, если не найдено.
+// Нужно только для сообщений проверки, поэтому простой поиск
+size_t findToken(std::string_view expression, std::string_view name)
+{
+    constexpr std::string_view Delimiters = " ()[]{};+-*/^<>=!";
+    for (size_t at = expression.find(name); at != std::string_view::npos;
+         at = expression.find(name, at + 1)) {
+        const size_t end = at + name.size();
+        const bool before = at == 0
+                            || Delimiters.find(expression[at - 1]) != std::string_view::npos;
+        const bool after = end == expression.size()
+                           || Delimiters.find(expression[end]) != std::string_view::npos;
+        if (before && after)
+            return at;
+    }
+    return 0;
+}
+
+// Роль символа в выражении; с символа Infix может начинаться оператор ('!' - только "!=")
+enum class CharClass : std::uint8_t { Operand, Open, Close, Separator, Infix };
+
+// Таблица ролей всех байтов: разбор обращается к ней для каждого символа выражения
+struct CharClasses
+{
+    CharClass of[256];
+
+    CharClasses()
+    {
+        for (int c = 0; c < 256; ++c)
+            of[c] = startsInfix(static_cast<char>(c)) ? CharClass::Infix : CharClass::Operand;
+        for (char c : Openers)
+            of[static_cast<unsigned char>(c)] = CharClass::Open;
+        for (char c : Closers)
+            of[static_cast<unsigned char>(c)] = CharClass::Close;
+        of[static_cast<unsigned char>(';')] = CharClass::Separator;
+    }
+
+    CharClass operator[](char c) const { return of[static_cast<unsigned char>(c)]; }
+};
+
+const CharClasses Classes;
+
+std::string unclosedBracket(char bracket)
+{
+    static const char *const Names[] = {"круглая", "квадратная", "фигурная"};
+    return std::string("ОШИБКА: Незакрытая ") + Names[Openers.find(bracket)] + " скобка "
+           + bracket;
+}
+
+// Причина ошибки быстрого пути, который вычисляет без сообщений
+ErrorCategory errorCategory(EvalStatus status)
+{
+    switch (status) {
+    case EvalStatus::DivisionByZero:
+        return ErrorCategory::DivisionByZero;
+    case EvalStatus::BadNumber:
+        return ErrorCategory::BadNumber;
+    default:
+        return ErrorCategory::Malformed;
+    }
+}
+
+} // namespace
+
+Engine::Engine(MessageSink sink)
+    : sink(std::move(sink))
+{}
+
+void Engine::setSink(MessageSink sink)
+{
+    this->sink = std::move(sink);
+}
+
+void Engine::setCache(EvalCache *cache)
+{
+    this->cache = cache;
+}
+
+void Engine::setMetrics(Metrics *metrics)
+{
+    this->metrics = metrics;
+}
+
+void Engine::setLogOptions(const LogOptions &options)
+{
+    logOptions = options;
+}
+
+void Engine::setProgress(ProgressSink progress)
+{
+    this->progress = std::move(progress);
+}
+
+void Engine::setCancelFlag(const std::atomic<bool> *flag)
+{
+    cancelFlag = flag;
+}
+
+void Engine::report(MessageKind kind, std::string_view text)
+{
+    if (sink)
+        sink(kind, std::string(text));
+}
+
+void Engine::fail(ErrorCategory category, std::string_view text)
+{
+    // Ошибка разбора одного из нескольких выражений: имя выражения после префикса
+    std::string scoped;
+    if (!errorScope.empty()) {
+        const size_t colon = text.find(": ");
+        const size_t at = colon == std::string_view::npos ? 0 : colon + 2;
+        scoped.append(text.substr(0, at)).append(errorScope).append(": ").append(text.substr(at));
+        text = scoped;
+    }
+    errorText += text;
+    errorText += '\n';
+#ifndef NATURE_NO_METRICS
+    if (metrics)
+        metrics->countError(category);
+#else
+    (void) category;
+#endif
+    report(MessageKind::Error, text);
+}
+
+void Engine::setPrecision(Precision precision)
+{
+    this->precision = precision;
+}
+
+void Engine::setPool(ThreadPool *pool)
+{
+    this->pool = pool;
+}
+
+bool Engine::interrupted(size_t done, size_t total)
+{
+    if (progress)
+        progress(done, total);
+    if (cancelFlag && cancelFlag->load(std::memory_order_relaxed)) {
+        fail(ErrorCategory::Cancelled, "Обработка прервана пользователем");
+        return true;
+    }
+    return false;
+}
+
+bool Engine::processFile(const std::string &fileName, double *result)
+{
+    StageTimer timer(metrics, Stage::File);
+    errorText.clear();
+    bool ok = runFile(fileName, result);
+#ifndef NATURE_NO_METRICS
+    if (metrics)
+        metrics->countFile(ok);
+#endif
+    return ok;
+}
+
+bool Engine::openFile(MappedFile &file, const std::string &fileName)
+{
+    StageTimer timer(metrics, Stage::Open);
+    if (file.open(fileName))
+        return true;
+    report(MessageKind::Info, "\nЧтение выражения из файла...");
+    fail(ErrorCategory::File, "ERROR: Файл не открыт");
+    report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+    return false;
+}
+
+bool Engine::processText(std::string_view text, double *result)
+{
+    StageTimer timer(metrics, Stage::File);
+    errorText.clear();
+    bool ok = runText(text, result);
+#ifndef NATURE_NO_METRICS
+    if (metrics)
+        metrics->countFile(ok);
+#endif
+    return ok;
+}
+
+bool Engine::runFile(const std::string &fileName, double *result)
+{
+    MappedFile file;
+    if (!openFile(file, fileName))
+        return false;
+    return runText(file.view(), result);
+}
+
+bool Engine::runText(std::string_view text, double *result)
+{
+    work.expressions.clear();
+    if (CompiledFile::isCompiled(text)) {
+        OperandMap operands;
+        if (!loadCompiled(text, work.program, operands))
+            return false;
+        if (!evaluate(work.program, operands, result)) {
+            report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+            return false;
+        }
+        return true;
+    }
+
+    // Текстовый путь целиком на рабочей памяти Engine: операнды сразу
+    // раскладываются по слотам скомпилированной программы, без std::map
+    std::string_view expression;
+    std::string_view first = text;
+    std::string_view name;
+    if (nextLine(first, expression) && ExpressionSet::splitLine(expression, name, expression))
+        return runExpressions(text);
+
+    work.rpn.clear();
+    if (!readExpression(text, expression)
+        || !compileExpression(expression, work.rpn, work.program)) {
+        report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+        return false;
+    }
+
+    const Program &program = work.program;
+    work.slots.assign(program.variableCount(), 0);
+    work.bound.assign(program.variableCount(), 0);
+    bool read = readOperandLines(text, 2, [&](std::string_view name, double value) {
+        int slot = program.findVariable(name);
+        if (slot >= 0) {
+            work.slots[slot] = value;
+            work.bound[slot] = 1;
+        }
+    });
+    if (!read) {
+        report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+        return false;
+    }
+
+    // Кэш результатов: только для полностью связанных корректных программ,
+    // ошибки вычисления не кэшируются и каждый раз сообщаются заново
+    bool memoize = cache && cache->cachesResults() && precision == Precision::Double
+                   && program.isWellFormed()
+                   && std::find(work.bound.begin(), work.bound.end(), 0) == work.bound.end();
+    double value = 0;
+    if (memoize && cache->findResult(expression, work.slots, value)) {
+        report(MessageKind::Success, "Результат для этих операндов взят из кэша");
+        if (sink)
+            report(MessageKind::Text, "\nРезультат: " + formatDouble(value));
+        if (result)
+            *result = value;
+        return true;
+    }
+
+    if (!evaluateSlots(program, &value)) {
+        report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+        return false;
+    }
+    if (memoize)
+        cache->storeResult(expression, work.slots, value);
+    if (result)
+        *result = value;
+    return true;
+}
+
+bool Engine::runExpressions(std::string_view text)
+{
+    // Выражения компилируются по мере чтения; ошибка в одном из них не мешает остальным
+    ExpressionSet &set = work.expressions;
+    report(MessageKind::Info, "\nЧтение выражений из файла...");
+    std::string_view rest = text;
+    std::string_view line;
+    std::string_view name;
+    std::string_view expression;
+    int lineNum = 1;
+    while (nextLine(rest, line) && ExpressionSet::splitLine(line, name, expression)) {
+        text = rest;
+        Program *program = set.add(name);
+        if (!program) {
+            fail(ErrorCategory::Syntax,
+                 "ERROR: Строка " + std::to_string(lineNum)
+                     + " - повторное имя выражения: " + std::string(name));
+            report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+            return false;
+        }
+        if (sink)
+            report(MessageKind::Note, "\nВыражение " + std::string(name) + ":");
+        report(MessageKind::Text, expression);
+        work.rpn.clear();
+        errorScope = name;
+        if (!compileExpression(expression, work.rpn, *program))
+            set.markFailed(set.size() - 1);
+        errorScope = std::string_view();
+        ++lineNum;
+    }
+    if (sink)
+        report(MessageKind::Success, "\nПрочитано выражений: " + std::to_string(set.size()));
+
+    // Строки операндов разбираются один раз на все выражения
+    set.bindOperands();
+    bool read = readOperandLines(text, lineNum, [&set](std::string_view name, double value) {
+        set.setOperand(name, value);
+    });
+    if (!read) {
+        report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+        return false;
+    }
+
+    {
+        StageTimer timer(metrics, Stage::Evaluate);
+        set.evaluate(precision, pool);
+    }
+    bool ok = true;
+    for (size_t i = 0; i < set.size(); ++i)
+        ok = reportExpression(i) && ok;
+    if (!ok)
+        report(MessageKind::Error, "Не все выражения файла вычислены из-за ошибок");
+    return ok;
+}
+
+bool Engine::reportExpression(size_t index)
+{
+    const ExpressionSet &set = work.expressions;
+    const ExpressionResult &result = set.result(index);
+    const std::string &name = set.name(index);
+    // Ошибка разбора уже учтена в метриках, поэтому строка пишется мимо fail()
+    if (!set.isCompiled(index)) {
+        const std::string text = "ERROR: " + name + ": выражение содержит ошибки";
+        errorText += text;
+        errorText += '\n';
+        report(MessageKind::Error, text);
+        return false;
+    }
+    if (result.status == EvalStatus::Ok) {
+        if (sink) {
+            report(MessageKind::Text,
+                   "\nРезультат " + name + ": "
+                       + (precision == Precision::Double
+                              ? formatDouble(result.value)
+                              : formatPrecise(result.value, result.bound)));
+        }
+        return true;
+    }
+
+    const Program &program = set.program(index);
+    if (result.undefined >= 0) {
+        fail(ErrorCategory::UndefinedOperand,
+             "ERROR: " + name + ": Неопределённый операнд: "
+                 + program.variableName(result.undefined));
+    } else if (result.status == EvalStatus::DivisionByZero) {
+        fail(ErrorCategory::DivisionByZero, "ERROR: " + name + ": деление на ноль");
+    } else if (result.status == EvalStatus::BadNumber) {
+        auto bad = std::find_if(program.code().begin(),
+                                program.code().end(),
+                                [](const Instruction &ins) { return ins.op == OpCode::BadNumber; });
+        fail(ErrorCategory::BadNumber,
+             "ERROR: " + name + ": Некорректный числовой формат: " + program.badToken(bad->arg));
+    } else {
+        fail(ErrorCategory::Malformed, "ERROR: " + name + ": Неверно сформированное RPN выражение");
+    }
+    return false;
+}
+
+bool Engine::loadFile(const std::string &fileName,
+                      Program &program,
+                      OperandMap &operands)
+{
+    errorText.clear();
+    MappedFile file;
+    if (!openFile(file, fileName))
+        return false;
+
+    if (CompiledFile::isCompiled(file.view()))
+        return loadCompiled(file.view(), program, operands);
+
+    std::string_view text = file.view();
+    std::string_view expression;
+    std::string_view first = text;
+    std::string_view name;
+    if (nextLine(first, expression) && ExpressionSet::splitLine(expression, name, expression)) {
+        report(MessageKind::Info, "\nЧтение выражения из файла...");
+        fail(ErrorCategory::Syntax,
+             "ERROR: Файл с несколькими выражениями вычисляется только целиком");
+        report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+        return false;
+    }
+
+    std::string RPN;
+    if (!readExpression(text, expression) || !compileExpression(expression, RPN, program)) {
+        report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+        return false;
+    }
+
+    if (!readOperands(text, operands)) {
+        report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+        return false;
+    }
+    return true;
+}
+
+bool Engine::compileExpression(std::string_view expression, std::string &rpn, Program &program)
+{
+    StageTimer timer(metrics, Stage::Convert);
+    EvalCache *programs = precision == Precision::Double ? cache : nullptr;
+    if (programs && programs->findProgram(expression, rpn, program)) {
+        report(MessageKind::Info, "\nВыражение уже проверено и скомпилировано: ОПЗ взята из кэша");
+    } else {
+        if (!convertToRPN(expression, rpn, program))
+            return false;
+        if (programs)
+            programs->storeProgram(expression, rpn, program);
+    }
+
+#ifndef NATURE_NO_METRICS
+    if (metrics)
+        metrics->countTokens(std::count(rpn.begin(), rpn.end(), ' '));
+#endif
+    report(MessageKind::Success, "Выражение конвентировано в ОПЗ:");
+    report(MessageKind::Text, rpn);
+    reportListing(program);
+    return true;
+}
+
+void Engine::reportListing(const Program &program)
+{
+    if (sink && logOptions.program) {
+        report(MessageKind::Note,
+               "Программа после оптимизации (" + std::to_string(program.code().size())
+                   + " команд):");
+        report(MessageKind::Text, program.listing());
+    }
+}
+
+bool Engine::loadCompiled(std::string_view bytes, Program &program, OperandMap &operands)
+{
+    StageTimer timer(metrics, Stage::Read);
+    report(MessageKind::Info, "\nЧтение скомпилированного выражения из файла...");
+
+    CompiledFile compiled;
+    std::string error;
+    if (!compiled.deserialize(bytes, error)) {
+        fail(ErrorCategory::File, error);
+        report(MessageKind::Error, "Обработка файла остановлена из-за ошибок");
+        return false;
+    }
+
+    report(MessageKind::Info, "Выражение успешно прочитано:");
+    report(MessageKind::Text, compiled.expression);
+    report(MessageKind::Success, "Выражение конвентировано в ОПЗ:");
+    report(MessageKind::Text, compiled.rpn);
+    for (size_t i = 0; sink && i < compiled.operands.size(); ++i) {
+        report(MessageKind::Note,
+               "Операнд: " + compiled.operands.name(i) + " = "
+                   + formatNumber(compiled.operands.value(i)));
+    }
+
+    // Файлы прежних версий записаны без свёртки констант
+    program = std::move(compiled.program);
+    program.optimize(precision != Precision::Double);
+    reportListing(program);
+    operands = std::move(compiled.operands);
+    return true;
+}
+
+bool Engine::convertToBinaryAndSave(const std::string &txtFileName, const std::string &binFileName)
+{
+    MappedFile inFile;
+    if (!inFile.open(txtFileName)) {
+        report(MessageKind::Error,
+               "ERROR: Не удалось открыть текстовый файл для конвертации: " + txtFileName);
+        return false;
+    }
+
+    // Проверка и компиляция идут молча: подробный журнал покажет обработка файла
+    CompiledFile compiled;
+    std::string_view text = inFile.view();
+    std::string_view expression;
+    MessageSink saved = std::move(sink);
+    sink = MessageSink();
+    Metrics *savedMetrics = metrics;
+    metrics = nullptr;
+    std::string_view first = text;
+    std::string_view name;
+    const bool several = nextLine(first, expression)
+                         && ExpressionSet::splitLine(expression, name, expression);
+    bool valid = !several && readExpression(text, expression)
+                 && convertToRPN(expression, compiled.rpn, compiled.program)
+                 && compiled.program.isWellFormed() && readOperands(text, compiled.operands);
+    sink = std::move(saved);
+    metrics = savedMetrics;
+
+    std::string bytes;
+    if (valid) {
+        compiled.expression = std::string(expression);
+        bytes = compiled.serialize();
+    } else {
+        // Файл с ошибками или с несколькими выражениями сохраняется в прежнем текстовом виде,
+        // чтобы при обработке пользователь увидел те же сообщения, что и раньше
+        text = inFile.view();
+        std::string_view line;
+        while (nextLine(text, line)) {
+            bytes += line;
+            bytes += '\n';
+        }
+    }
+
+    std::ofstream outFile(binFileName, std::ios::out | std::ios::binary);
+    if (!outFile.is_open()) {
+        report(MessageKind::Error, "ERROR: Не удалось создать бинарный файл: " + binFileName);
+        return false;
+    }
+    outFile.write(bytes.data(), bytes.size());
+    outFile.close();
+    if (!outFile) {
+        report(MessageKind::Error, "ERROR: Ошибка записи бинарного файла: " + binFileName);
+        return false;
+    }
+
+    if (valid) {
+        report(MessageKind::Success, "Файл успешно преобразован в бинарный: " + binFileName);
+    } else if (several) {
+        report(MessageKind::Note,
+               "Формат .bin хранит одно выражение: файл сохранён в текстовом формате "
+                   + binFileName);
+    } else {
+        report(MessageKind::Note,
+               "Выражение содержит ошибки: файл сохранён в текстовом формате " + binFileName);
+    }
+    return true;
+}
+
+bool Engine::readExpression(std::string_view &text, std::string_view &expression)
+{
+    StageTimer timer(metrics, Stage::Read);
+    report(MessageKind::Info, "\nЧтение выражения из файла...");
+
+    if (!nextLine(text, expression)) {
+        fail(ErrorCategory::Syntax, "ERROR: Файл пуст");
+        return false;
+    }
+
+    report(MessageKind::Info, "Выражение успешно прочитано:");
+    report(MessageKind::Text, expression);
+    return true;
+}
+
+bool Engine::convertToRPN(std::string_view expression, std::string &B, Program &program)
+{
+    report(MessageKind::Info, "\nПреобразование в ОПЗ и проверка на ошибки...");
+
+    std::vector<Diagnostic> &errors = work.errors;
+    errors.clear();
+    if (!parseExpression(expression, B, errors, false)) {
+        report(MessageKind::Note, "Выражение: " + work.echo);
+        fail(errors.front().category, errors.front().message);
+        return false;
+    }
+
+    if (B.empty()) {
+        fail(ErrorCategory::Syntax, "ОШИБКА: Пустое выражение после преобразования");
+        return false;
+    }
+
+    program.compile(B);
+    program.optimize(precision != Precision::Double);
+    report(MessageKind::Success, "Выражение успешно обработано");
+    return true;
+}
+
+bool Engine::parseExpression(std::string_view expression,
+                             std::string &B,
+                             std::vector<Diagnostic> &errors,
+                             bool all)
+{
+    std::vector<Pending> &stack1 = work.operators;
+    stack1.clear();
+    const size_t errorsBefore = errors.size();
+    bool stop = false;
+    Previous pred = Previous::Start;
+    std::string_view predText; // запись предыдущего токена для сообщений
+    size_t operandBegin = 0;   // начало текущего операнда в выражении
+    size_t operandStart = 0;   // и в B
+    // Прочитанная часть выражения для сообщения об ошибке; при сборе всех ошибок не нужна
+    std::string &expressionOutput = work.echo;
+    expressionOutput.clear();
+
+    // Все сообщения о скобках упоминают их, остальные - об операторах и операндах
+    auto error = [&](size_t offset, std::string message) {
+        ErrorCategory category = message.find("скоб") != std::string::npos
+                                     ? ErrorCategory::Brackets
+                                     : ErrorCategory::Syntax;
+        errors.push_back({category, 1, columnOf(expression, offset), std::move(message)});
+        stop = !all;
+    };
+    // Текущий операнд без пробелов по краям: перед '(' он может быть именем функции
+    auto operandName = [&](size_t end) {
+        std::string_view name = expression.substr(operandBegin, end - operandBegin);
+        size_t first = name.find_first_not_of(' ');
+        size_t last = name.find_last_not_of(' ');
+        return first == std::string_view::npos ? std::string_view()
+                                               : name.substr(first, last - first + 1);
+    };
+    auto functionNamed = [](std::string_view name) -> const Operator * {
+        const Operator *entry = findOperator(name);
+        return entry && entry->precedence == 0 ? entry : nullptr;
+    };
+    auto popOperator = [&]() {
+        B += stack1.back().op->name;
+        B.push_back(' ');
+        stack1.pop_back();
+    };
+    // Скобка снимается со стека вместе с функцией, которой принадлежит
+    auto dropBracket = [&]() {
+        stack1.pop_back();
+        if (!stack1.empty() && stack1.back().bracket == 0 && stack1.back().op->precedence == 0)
+            stack1.pop_back();
+    };
+
+    size_t index = 0;
+    while (index < expression.size() && !stop) {
+        const size_t at = index;
+        const char a = expression[index];
+        const CharClass kind = Classes[a];
+        // Продолжение операнда - самый частый случай, ему не нужны поиски по таблицам
+        if (pred == Previous::Operand && kind == CharClass::Operand) {
+            B.back() = a;
+            B.push_back(' ');
+            if (!all)
+                expressionOutput += a;
+            ++index; // predText после операнда не нужен ни одному сообщению
+            continue;
+        }
+        const Operator *infix = kind == CharClass::Infix ? matchInfix(expression.substr(index))
+                                                         : nullptr;
+        const std::string_view token = infix ? std::string_view(infix->name)
+                                             : expression.substr(index, 1);
+        index += token.size();
+        if (!all)
+            expressionOutput += token;
+        const size_t opening = kind == CharClass::Open ? Openers.find(a) : std::string_view::npos;
+        const size_t closing = kind == CharClass::Close ? Closers.find(a) : std::string_view::npos;
+        const bool operandChar = !infix && opening == std::string_view::npos
+                                 && closing == std::string_view::npos && a != ';';
+
+        // Имена функций зарезервированы: без '(' такой операнд - ошибка
+        if (pred == Previous::Operand && !operandChar && opening == std::string_view::npos) {
+            if (const Operator *function = functionNamed(operandName(at))) {
+                error(operandName(at).data() - expression.data(),
+                      std::string("ОШИБКА: После имени функции ") + function->name
+                          + " ожидается '('");
+                if (stop)
+                    break;
+            }
+        }
+
+        if (opening != std::string_view::npos) {
+            const Operator *function = pred == Previous::Operand ? functionNamed(operandName(at))
+                                                                 : nullptr;
+            if (function) {
+                const size_t offset = operandName(at).data() - expression.data();
+                B.resize(operandStart);
+                stack1.push_back({0, function, 0, static_cast<std::uint32_t>(offset)});
+            } else if (pred == Previous::Operand || pred == Previous::Close) {
+                error(at, std::string("ОШИБКА: Отсутствует оператор перед '") + a + "'");
+            }
+            stack1.push_back({a, nullptr, 0, static_cast<std::uint32_t>(at)});
+        } else if (infix && index == expression.size()) {
+            error(at, "ОШИБКА: Отсутствует правый операнд после '" + std::string(token) + "'");
+        } else if (closing != std::string_view::npos) {
+            const char opener = Openers[closing];
+            bool reported = true;
+            if (pred == Previous::Open && predText[0] == opener) {
+                error(at, std::string("ОШИБКА: Пустые скобки ") + opener + a);
+            } else if (pred == Previous::Operator) {
+                error(at, "ОШИБКА: Отсутствует правый операнд");
+            } else if (pred == Previous::Separator) {
+                error(at, "ОШИБКА: Отсутствует аргумент после ';'");
+            } else {
+                reported = false;
+            }
+            if (stop)
+                break;
+
+            // Чужая скобка на пути к своей считается незакрытой и снимается
+            while (!stop && !stack1.empty() && stack1.back().bracket != opener) {
+                if (stack1.back().bracket != 0) {
+                    error(stack1.back().offset, unclosedBracket(stack1.back().bracket));
+                    dropBracket();
+                } else {
+                    popOperator();
+                }
+            }
+            if (stop)
+                break;
+            if (stack1.empty()) {
+                error(at,
+                      std::string("ОШИБКА: Несоответствие скобок - нет открывающей скобки для ")
+                          + a);
+            } else {
+                const std::uint32_t arguments = stack1.back().separators + 1;
+                stack1.pop_back();
+                if (!stack1.empty() && stack1.back().bracket == 0
+                    && stack1.back().op->precedence == 0) {
+                    const Operator *function = stack1.back().op;
+                    if (!reported && arguments != static_cast<std::uint32_t>(function->arity))
+                        error(stack1.back().offset,
+                              std::string("ОШИБКА: Неверное число аргументов функции ")
+                                  + function->name + ": ожидается "
+                                  + std::to_string(function->arity) + ", указано "
+                                  + std::to_string(arguments));
+                    popOperator();
+                }
+            }
+        } else if (a == ';') {
+            if (pred == Previous::Operator)
+                error(at, "ОШИБКА: Отсутствует правый операнд");
+            else if (pred != Previous::Operand && pred != Previous::Close)
+                error(at, "ОШИБКА: Отсутствует аргумент перед ';'");
+            if (stop)
+                break;
+            while (!stack1.empty() && stack1.back().bracket == 0)
+                popOperator();
+            // Под скобкой аргументов должна лежать функция
+            const Pending *owner = stack1.size() >= 2 ? &stack1[stack1.size() - 2] : nullptr;
+            if (!owner || owner->bracket != 0 || owner->op->precedence != 0)
+                error(at, "ОШИБКА: ';' вне аргументов функции");
+            else
+                ++stack1.back().separators;
+        } else if (infix) {
+            const bool start = pred == Previous::Start || pred == Previous::Open
+                               || pred == Previous::Separator;
+            if (start && (infix->op == OpCode::Add || infix->op == OpCode::Subtract)) {
+                // Унарный плюс или минус: 0 + x и 0 - x
+                stack1.push_back({0, infix, 0, static_cast<std::uint32_t>(at)});
+                B.push_back('0');
+                B.push_back(' ');
+                if (!all)
+                    expressionOutput += "0";
+            } else if (pred == Previous::Operator) {
+                // Второй оператор подряд пропускается
+                error(at,
+                      "ОШИБКА: Два оператора подряд: '" + std::string(predText)
+                          + std::string(token) + "'");
+            } else {
+                if (start)
+                    error(at,
+                          "ОШИБКА: Отсутствует левый операнд для '" + std::string(token) + "'");
+                // Вынимаем операции, которые связывают сильнее, и равные - для левоассоциативных
+                while (!stack1.empty() && stack1.back().bracket == 0
+                       && (stack1.back().op->precedence > infix->precedence
+                           || (stack1.back().op->precedence == infix->precedence
+                               && !infix->rightAssociative)))
+                    popOperator();
+                stack1.push_back({0, infix, 0, static_cast<std::uint32_t>(at)});
+            }
+        } else {
+            if (pred == Previous::Close)
+                error(at,
+                      "ОШИБКА: Отсутствует оператор после '" + std::string(predText)
+                          + "' перед '" + a + "'");
+            if (pred == Previous::Operand) {
+                // Для многосимвольных операндов удаляем пробел между символами
+                if (!B.empty())
+                    B.pop_back();
+            } else {
+                operandBegin = at;
+                operandStart = B.size();
+            }
+            B.push_back(a);
+            B.push_back(' ');
+        }
+
+        pred = opening != std::string_view::npos   ? Previous::Open
+               : closing != std::string_view::npos ? Previous::Close
+               : a == ';'                          ? Previous::Separator
+               : infix                             ? Previous::Operator
+                                                   : Previous::Operand;
+        predText = token;
+    }
+
+    if (!stop && pred == Previous::Operand) {
+        if (const Operator *function = functionNamed(operandName(expression.size())))
+            error(operandName(expression.size()).data() - expression.data(),
+                  std::string("ОШИБКА: После имени функции ") + function->name + " ожидается '('");
+    }
+
+    while (!stack1.empty() && !stop) {
+        if (stack1.back().bracket != 0) {
+            error(stack1.back().offset, unclosedBracket(stack1.back().bracket));
+            dropBracket();
+        } else {
+            popOperator();
+        }
+    }
+    return errors.size() == errorsBefore;
+}
+
+namespace {
+
+std::string_view trimView(std::string_view text)
+{
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+        return std::string_view();
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+enum class LineProblem { None, NoEquals, NoName, NumericName, NoValue, BadValue };
+
+// Строка "имя = значение"; при ошибке name и valueText - части строки для сообщения
+struct OperandLine
+{
+    LineProblem problem = LineProblem::None;
+    std::string_view name;
+    std::string_view valueText;
+    double value = 0;
+};
+
+OperandLine parseOperandLine(std::string_view line)
+{
+    OperandLine parsed;
+    size_t pos = line.find('=');
+    if (pos == std::string_view::npos) {
+        parsed.problem = LineProblem::NoEquals;
+        return parsed;
+    }
+    parsed.name = trimView(line.substr(0, pos));
+    parsed.valueText = trimView(line.substr(pos + 1));
+    if (parsed.name.empty())
+        parsed.problem = LineProblem::NoName;
+    else if (isAllDigits(parsed.name))
+        parsed.problem = LineProblem::NumericName;
+    else if (parsed.valueText.empty())
+        parsed.problem = LineProblem::NoValue;
+    else if (!parseNumber(parsed.valueText, parsed.value))
+        parsed.problem = LineProblem::BadValue;
+    return parsed;
+}
+
+ErrorCategory lineCategory(const OperandLine &parsed)
+{
+    return parsed.problem == LineProblem::BadValue ? ErrorCategory::BadNumber
+                                                   : ErrorCategory::OperandLine;
+}
+
+// Причина ошибки без номера строки
+std::string lineProblemText(const OperandLine &parsed)
+{
+    switch (parsed.problem) {
+    case LineProblem::NoEquals:
+        return "пропуск '='";
+    case LineProblem::NoName:
+        return "отсутствует имя операнда";
+    case LineProblem::NumericName:
+        return "имя операнда не может быть числом: '" + std::string(parsed.name) + "'";
+    case LineProblem::NoValue:
+        return "пропущено значение операнда";
+    default:
+        return "некорректное значение: '" + std::string(parsed.valueText) + "'";
+    }
+}
+
+// Смещение ошибочной части в строке: имя, значение или её начало
+size_t lineProblemOffset(const OperandLine &parsed, std::string_view line)
+{
+    if (parsed.problem == LineProblem::NumericName)
+        return parsed.name.data() - line.data();
+    if (parsed.problem == LineProblem::BadValue)
+        return parsed.valueText.data() - line.data();
+    if (parsed.problem == LineProblem::NoValue)
+        return line.find('=') + 1;
+    return 0;
+}
+
+} // namespace
+
+// Разбор строк "имя = значение"; store(name, value) решает, куда положить значение
+template <typename Store>
+bool Engine::readOperandLines(std::string_view text, int firstLine, Store &&store)
+{
+    StageTimer timer(metrics, Stage::Operands);
+    // Отмена и ход обработки проверяются раз в ProgressLines строк, чтобы не тормозить разбор
+    constexpr int ProgressLines = 4096;
+    const bool watched = progress || cancelFlag;
+    const char *const begin = text.data();
+    const size_t total = text.size();
+
+    std::string_view line;
+    int lineNum = firstLine;
+    int operands = 0;
+    int sinceCheck = 0;
+    size_t logged = 0;
+    while (nextLine(text, line)) {
+        if (watched && ++sinceCheck == ProgressLines) {
+            sinceCheck = 0;
+            if (interrupted(static_cast<size_t>(line.data() - begin), total))
+                return false;
+        }
+        // Пустые строки тоже считаются, чтобы номер в сообщении совпадал с файлом
+        if (line.empty()) {
+            lineNum++;
+            continue;
+        }
+
+        const OperandLine parsed = parseOperandLine(line);
+        if (parsed.problem != LineProblem::None) {
+            fail(lineCategory(parsed),
+                 "ERROR: Строка " + std::to_string(lineNum) + " - " + lineProblemText(parsed));
+            return false;
+        }
+        const std::string_view name = parsed.name;
+        const double value = parsed.value;
+
+        store(name, value);
+        if (sink && logged <= logOptions.maxOperands) {
+            if (logged++ < logOptions.maxOperands)
+                report(MessageKind::Note,
+                       "Операнд: " + std::string(name) + " = " + formatNumber(value));
+            else
+                report(MessageKind::Note, "... остальные операнды не показываются");
+        }
+
+        lineNum++;
+        operands++;
+    }
+#ifndef NATURE_NO_METRICS
+    if (metrics)
+        metrics->countOperands(operands);
+#endif
+    if (watched)
+        return !interrupted(total, total);
+    return true;
+}
+
+bool Engine::readOperands(std::string_view text, OperandMap &operands)
+{
+    return readOperandLines(text, 2, [&operands](std::string_view name, double value) {
+        operands.set(name, value);
+    });
+}
+
+bool Engine::validateFile(const std::string &fileName, std::vector<Diagnostic> &diagnostics)
+{
+    StageTimer timer(metrics, Stage::File);
+    diagnostics.clear();
+    MappedFile file;
+    bool opened = false;
+    {
+        StageTimer openTimer(metrics, Stage::Open);
+        opened = file.open(fileName);
+    }
+
+    bool ok = false;
+    if (!opened)
+        diagnostics.push_back({ErrorCategory::File, 1, 1, "ERROR: Файл не открыт"});
+    else if (CompiledFile::isCompiled(file.view()))
+        ok = validateCompiled(file.view(), diagnostics);
+    else
+        ok = validate(file.view(), diagnostics);
+
+#ifndef NATURE_NO_METRICS
+    if (metrics) {
+        metrics->countFile(ok);
+        for (const Diagnostic &diagnostic : diagnostics)
+            metrics->countError(diagnostic.category);
+    }
+#endif
+    if (sink) {
+        for (const Diagnostic &diagnostic : diagnostics) {
+            report(MessageKind::Error,
+                   "Строка " + std::to_string(diagnostic.line) + ", столбец "
+                       + std::to_string(diagnostic.column) + ": " + diagnostic.message);
+        }
+        if (ok)
+            report(MessageKind::Success, "Ошибок не найдено");
+    }
+    return ok;
+}
+
+bool Engine::validate(std::string_view text, std::vector<Diagnostic> &diagnostics)
+{
+    diagnostics.clear();
+    std::string_view rest = text;
+    std::string_view expression;
+    if (!nextLine(rest, expression)) {
+        diagnostics.push_back({ErrorCategory::Syntax, 1, 1, "ERROR: Файл пуст"});
+        return false;
+    }
+
+    // Строки выражений: первая или все именованные подряд с начала файла
+    std::string_view name;
+    const bool several = ExpressionSet::splitLine(expression, name, expression);
+    size_t expressionLines = 1;
+    std::string_view line;
+    for (std::string_view next = rest;
+         several && nextLine(next, line) && ExpressionSet::splitLine(line, name, expression);
+         rest = next)
+        ++expressionLines;
+
+    // Строки операндов: все ошибки и имена заданных операндов
+    SymbolTable &defined = work.defined;
+    defined.clear();
+    {
+        StageTimer timer(metrics, Stage::Operands);
+        size_t lineNum = expressionLines;
+        while (nextLine(rest, line)) {
+            ++lineNum;
+            if (line.empty())
+                continue;
+            const OperandLine parsed = parseOperandLine(line);
+            if (parsed.problem == LineProblem::None) {
+                defined.intern(parsed.name);
+                continue;
+            }
+            diagnostics.push_back({lineCategory(parsed),
+                                   lineNum,
+                                   columnOf(line, lineProblemOffset(parsed, line)),
+                                   "ERROR: " + lineProblemText(parsed)});
+        }
+    }
+
+    SymbolTable names; // имена выражений, для поиска повторов
+    rest = text;
+    for (size_t lineNum = 1; lineNum <= expressionLines && nextLine(rest, line); ++lineNum) {
+        expression = line;
+        if (several) {
+            ExpressionSet::splitLine(line, name, expression);
+            if (names.find(name) >= 0)
+                diagnostics.push_back({ErrorCategory::Syntax,
+                                       lineNum,
+                                       columnOf(line, name.data() - line.data()),
+                                       "ERROR: повторное имя выражения: " + std::string(name)});
+            names.intern(name);
+        }
+        const size_t before = diagnostics.size();
+        validateExpression(expression, diagnostics);
+        const size_t shift = columnOf(line, expression.data() - line.data()) - 1;
+        for (size_t i = before; i < diagnostics.size(); ++i) {
+            diagnostics[i].line = lineNum;
+            diagnostics[i].column += shift;
+        }
+    }
+
+    std::stable_sort(diagnostics.begin(),
+                     diagnostics.end(),
+                     [](const Diagnostic &a, const Diagnostic &b) {
+                         return a.line != b.line ? a.line < b.line : a.column < b.column;
+                     });
+    return diagnostics.empty();
+}
+
+void Engine::validateExpression(std::string_view expression, std::vector<Diagnostic> &diagnostics)
+{
+    // Разбор без остановки и компиляция без оптимизации - по ней видны
+    // некорректные числа и неопределённые операнды (по work.defined). Ошибка разбора
+    // уже объясняет неверно сформированную программу, поэтому та сообщается только отдельно
+    StageTimer timer(metrics, Stage::Convert);
+    const SymbolTable &defined = work.defined;
+    std::string &rpn = work.rpn;
+    rpn.clear();
+    const bool parsed = parseExpression(expression, rpn, diagnostics, true);
+    if (parsed && rpn.empty()) {
+        diagnostics.push_back(
+            {ErrorCategory::Syntax, 1, 1, "ОШИБКА: Пустое выражение после преобразования"});
+        return;
+    }
+    Program &program = work.program;
+    program.compile(rpn);
+    bool badNumbers = false;
+    for (const Instruction &ins : program.code()) {
+        if (ins.op != OpCode::BadNumber)
+            continue;
+        badNumbers = true;
+        const std::string &token = program.badToken(ins.arg);
+        diagnostics.push_back({ErrorCategory::BadNumber,
+                               1,
+                               columnOf(expression, findToken(expression, token)),
+                               "ERROR: Некорректный числовой формат: " + token});
+    }
+    if (parsed && !badNumbers && !program.isWellFormed())
+        diagnostics.push_back(
+            {ErrorCategory::Malformed, 1, 1, "ERROR: Неверно сформированное RPN выражение"});
+    for (size_t slot = 0; slot < program.variableCount(); ++slot) {
+        const std::string &name = program.variableName(slot);
+        if (defined.find(name) < 0)
+            diagnostics.push_back({ErrorCategory::UndefinedOperand,
+                                   1,
+                                   columnOf(expression, findToken(expression, name)),
+                                   "ERROR: Неопределённый операнд: " + name});
+    }
+}
+
+bool Engine::validateCompiled(std::string_view bytes, std::vector<Diagnostic> &diagnostics)
+{
+    StageTimer timer(metrics, Stage::Read);
+    CompiledFile compiled;
+    std::string error;
+    if (!compiled.deserialize(bytes, error)) {
+        diagnostics.push_back({ErrorCategory::File, 1, 1, error});
+        return false;
+    }
+    const Program &program = compiled.program;
+    for (size_t slot = 0; slot < program.variableCount(); ++slot) {
+        const std::string &name = program.variableName(slot);
+        if (!compiled.operands.find(name))
+            diagnostics.push_back(
+                {ErrorCategory::UndefinedOperand,
+                 1,
+                 columnOf(compiled.expression, findToken(compiled.expression, name)),
+                 "ERROR: Неопределённый операнд: " + name});
+    }
+    return diagnostics.empty();
+}
+
+bool Engine::evaluate(const Program &program,
+                      const OperandMap &operands,
+                      double *result)
+{
+    work.slots.assign(program.variableCount(), 0);
+    work.bound.assign(program.variableCount(), 0);
+    for (size_t slot = 0; slot < program.variableCount(); ++slot) {
+        if (const double *value = operands.find(program.variableName(slot))) {
+            work.slots[slot] = *value;
+            work.bound[slot] = 1;
+        }
+    }
+    return evaluateSlots(program, result);
+}
+
+bool Engine::evaluateSlots(const Program &program, double *result)
+{
+    StageTimer timer(metrics, Stage::Evaluate);
+    const std::vector<double> &slots = work.slots;
+    std::vector<double> &stack = work.stack;
+    stack.resize(program.frameSize() + 1);
+    double value = 0;
+    const bool complete = program.isWellFormed()
+                          && std::find(work.bound.begin(), work.bound.end(), 0)
+                                 == work.bound.end();
+
+    // Оценка погрешности - без шагов расчета: они в журнале только для double.
+    // Ошибки некорректной программы и неверные числа сообщает обычный путь ниже
+    if (precision != Precision::Double && complete) {
+        PreciseResult precise;
+        const EvalStatus status = work.precise.evaluate(program, slots.data(), precision, precise);
+        if (status == EvalStatus::DivisionByZero) {
+            fail(ErrorCategory::DivisionByZero, "ERROR: деление на ноль");
+            return false;
+        }
+        if (status == EvalStatus::Ok) {
+            bound = precise.bound;
+            if (result)
+                *result = precise.value;
+            if (sink)
+                report(MessageKind::Text,
+                       "\nРезультат: " + formatPrecise(precise.value, precise.bound));
+            return true;
+        }
+    }
+
+    // Без приёмника сообщений и при корректной программе - быстрый путь без журнала
+    if (!sink && complete) {
+        EvalStatus status = program.evaluate(slots.data(), stack.data(), value);
+        if (status != EvalStatus::Ok) {
+            // Программа корректна, поэтому ошибка здесь - только деление на ноль
+            fail(errorCategory(status),
+                 status == EvalStatus::DivisionByZero
+                     ? "ERROR: деление на ноль"
+                     : "ERROR: Неверно сформированное RPN выражение");
+            return false;
+        }
+        if (result)
+            *result = value;
+        return true;
+    }
+
+    // Подробный журнал медленный: на длинных выражениях проверяем отмену по ходу
+    constexpr size_t ProgressSteps = 1024;
+    const bool watched = progress || cancelFlag;
+    const size_t steps = program.code().size();
+    size_t step = 0;
+
+    // Временные ячейки общих подвыражений - сразу за стеком, как в Program::evaluate
+    double *temp = stack.data() + program.stackDepth() + 1;
+    size_t depth = 0;
+    std::string calculationLog = "Шаги расчета:\n";
+    size_t loggedSteps = 0;
+    auto logStep = [&]() { return logOptions.steps && loggedSteps++ < logOptions.maxSteps; };
+
+    for (const Instruction &ins : program.code()) {
+        if (watched && ++step % ProgressSteps == 0 && interrupted(step, steps))
+            return false;
+        switch (ins.op) {
+        case OpCode::Constant:
+            stack[depth++] = program.constant(ins.arg);
+            if (logStep())
+                calculationLog += "\n  Поместили операнд: " + formatNumber(program.constant(ins.arg));
+            break;
+        case OpCode::Variable: {
+            const std::string &name = program.variableName(ins.arg);
+            if (!work.bound[ins.arg]) {
+                fail(ErrorCategory::UndefinedOperand, "ERROR: Неопределённый операнд: " + name);
+                return false;
+            }
+            stack[depth++] = slots[ins.arg];
+            if (logStep())
+                calculationLog += "\n  Поместили операнд " + name + " = "
+                                  + formatNumber(slots[ins.arg]);
+            break;
+        }
+        case OpCode::BadNumber:
+            fail(ErrorCategory::BadNumber,
+                 "ERROR: Некорректный числовой формат: " + program.badToken(ins.arg));
+            return false;
+        case OpCode::Store:
+            if (depth < 1) {
+                fail(ErrorCategory::Malformed, "ERROR: Неверно сформированное RPN выражение");
+                return false;
+            }
+            temp[ins.arg] = stack[depth - 1];
+            break;
+        case OpCode::Load:
+            stack[depth++] = temp[ins.arg];
+            if (logStep())
+                calculationLog += "\n  Повторно использовали результат: "
+                                  + formatNumber(temp[ins.arg]);
+            break;
+        case OpCode::Negate: {
+            if (depth < 1) {
+                fail(ErrorCategory::Malformed, "ERROR: Недостаточно операндов для оператора: -");
+                return false;
+            }
+            double a = stack[depth - 1];
+            value = 0.0 - a;
+            if (logStep())
+                calculationLog += "\n  0 - " + formatNumber(a) + " = " + formatNumber(value);
+            stack[depth - 1] = value;
+            break;
+        }
+        default: {
+            const std::string op = operatorName(ins.op);
+            const size_t operands = arity(ins.op);
+            if (depth < operands) {
+                fail(ErrorCategory::Malformed,
+                     "ERROR: Недостаточно операндов для оператора: " + op);
+                return false;
+            }
+            if (operands == 1) {
+                double a = stack[depth - 1];
+                value = applyUnary(ins.op, a);
+                if (logStep())
+                    calculationLog += "\n  " + op + "(" + formatNumber(a) + ") = "
+                                      + formatNumber(value);
+                stack[depth - 1] = value;
+                break;
+            }
+            double b = stack[--depth];
+            double a = stack[--depth];
+
+            if (ins.op == OpCode::Divide && b == 0) {
+                fail(ErrorCategory::DivisionByZero, "ERROR: деление на ноль");
+                return false;
+            }
+            value = applyBinary(ins.op, a, b);
+
+            if (logStep()) {
+                // Функции - в записи выражения: min(a; b)
+                if (operatorFor(ins.op)->precedence == 0)
+                    calculationLog += "\n  " + op + "(" + formatNumber(a) + "; " + formatNumber(b)
+                                      + ") = " + formatNumber(value);
+                else
+                    calculationLog += "\n  " + formatNumber(a) + " " + op + " " + formatNumber(b)
+                                      + " = " + formatNumber(value);
+            }
+            stack[depth++] = value;
+            break;
+        }
+        }
+    }
+
+    if (depth != 1) {
+        fail(ErrorCategory::Malformed, "ERROR: Неверно сформированное RPN выражение");
+        return false;
+    }
+    if (result)
+        *result = stack[0];
+
+    if (logOptions.steps) {
+        if (loggedSteps > logOptions.maxSteps)
+            calculationLog += "\n  ... ещё " + std::to_string(loggedSteps - logOptions.maxSteps)
+                              + " шагов не показано";
+        report(MessageKind::Success, calculationLog);
+    }
+    report(MessageKind::Text, "\nРезультат: " + formatDouble(stack[0]));
+    return true;
+}
+
+std::string Engine::formatDouble(double value)
+{
+    char buffer[64];
+    auto res = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 10);
+    std::string result(buffer, res.ptr);
+    std::replace(result.begin(), result.end(), '.', ',');
+
+    size_t comma = result.find(',');
+    if (comma != std::string::npos) {
+        std::string fraction = result.substr(comma + 1);
+        if (std::strtod(fraction.c_str(), nullptr) == 0)
+            result.erase(comma);
+    }
+    return result;
+}
+
+std::string Engine::formatPrecise(double value, double bound)
+{
+    // Кратчайшая запись, которая читается обратно в то же value
+    char buffer[64];
+    auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    std::string result(buffer, res.ptr);
+    if (std::isfinite(bound) && bound > 0) {
+        // Граница округляется вверх: напечатанная не должна быть меньше настоящей.
+        // Запись вида "d.de-XX": bound ~ digits * 10^exponent
+        res = std::to_chars(buffer, buffer + sizeof(buffer), bound,
+                            std::chars_format::scientific, 1);
+        int digits = (buffer[0] - '0') * 10 + (buffer[2] - '0');
+        int exponent = 0;
+        std::from_chars(buffer + (buffer[4] == '+' ? 5 : 4), res.ptr, exponent);
+        --exponent;
+        double printed = 0;
+        std::from_chars(buffer, res.ptr, printed);
+        // Равенство после чтения точно, только если десятичная запись представима в double
+        const bool exact = printed == bound
+                           && ((exponent >= 0 && exponent <= 15)
+                               || (exponent == -1 && digits % 5 == 0)
+                               || (exponent == -2 && digits % 25 == 0));
+        if (!exact && printed <= bound) {
+            const std::string up = std::to_string(++digits) + "e" + std::to_string(exponent);
+            std::from_chars(up.data(), up.data() + up.size(), bound);
+        }
+    }
+    res = std::to_chars(buffer, buffer + sizeof(buffer), bound, std::chars_format::general, 2);
+    result += " ± ";
+    result.append(buffer, res.ptr);
+    std::replace(result.begin(), result.end(), '.', ',');
+    return result;
+}
+
+// Аналог QString::arg(double): формат 'g' с 6 значащими цифрами
+std::string Engine::formatNumber(double value)
+{
+    char buffer[64];
+    auto res = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    return std::string(buffer, res.ptr);
+}
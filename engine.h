@@ -0,0 +1,191 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "expressions.h"
+#include "precise.h"
+#include "program.h"
+
+class EvalCache;
+class MappedFile;
+class Metrics;
+enum class ErrorCategory;
+struct Operator;
+class ThreadPool;
+
+// Тип сообщения определяет, как его покажет интерфейс (в GUI - цвет строки)
+enum class MessageKind { Info, Text, Note, Success, Error };
+
+using MessageSink = std::function<void(MessageKind kind, const std::string &text)>;
+// Ход обработки файла: done из total (в байтах строк операндов или в шагах вычисления)
+using ProgressSink = std::function<void(size_t done, size_t total)>;
+
+// Подробность журнала для приёмника сообщений. По умолчанию журнал полный;
+// на больших файлах шаги расчета отключают, а число строк операндов и шагов ограничивают
+struct LogOptions
+{
+    bool steps = true;
+    bool program = false; // листинг оптимизированной программы
+
+    size_t maxOperands = SIZE_MAX;
+    size_t maxSteps = SIZE_MAX;
+};
+
+// Ошибка, найденная проверкой файла; строка и столбец считаются с 1,
+// столбец - в символах UTF-8
+struct Diagnostic
+{
+    ErrorCategory category;
+    size_t line;
+    size_t column;
+    std::string message;
+};
+
+// Конвейер чтение -> ОПЗ -> вычисление без зависимости от Qt и GUI.
+// Engine хранит рабочую память между файлами и после первых файлов обрабатывает
+// новое выражение без выделений в куче (если нет приёмника сообщений).
+// Поэтому один Engine используется одним потоком
+class Engine
+{
+public:
+    explicit Engine(MessageSink sink = MessageSink());
+
+    void setSink(MessageSink sink);
+    // Общий кэш программ и результатов (может разделяться между Engine разных потоков);
+    // nullptr - без кэша
+    void setCache(EvalCache *cache);
+    // Общие счётчики и гистограммы этапов (metrics.h); nullptr - без замеров
+    void setMetrics(Metrics *metrics);
+    void setLogOptions(const LogOptions &options);
+    void setProgress(ProgressSink progress);
+    // Флаг отмены проверяется между строками операндов и шагами вычисления;
+    // может выставляться из другого потока. nullptr - без отмены
+    void setCancelFlag(const std::atomic<bool> *flag);
+    // Interval и Compensated вычисляют с гарантированной границей погрешности
+    // (precise.h): константы сворачиваются только точно, кэш не используется -
+    // в нём программы со свёрткой в double
+    void setPrecision(Precision precision);
+    // Граница погрешности результата последнего вычисления в режимах с оценкой
+    double errorBound() const { return bound; }
+    // Пул для параллельного вычисления выражений файла с несколькими выражениями;
+    // nullptr - в вызывающем потоке. Engine не должен работать внутри задачи этого пула
+    void setPool(ThreadPool *pool);
+
+    // Файл с несколькими именованными выражениями (expressions.h) разбирается один раз,
+    // его результаты - в expressions(), а result не меняется. false - хотя бы одно
+    // выражение не вычислено
+    bool processFile(const std::string &fileName, double *result = nullptr);
+    // Содержимое файла уже в памяти (например, запрос сервера): разбирается так же,
+    // как файл, и учитывается в метриках как файл
+    bool processText(std::string_view text, double *result = nullptr);
+    // Ошибки последнего processFile/processText/loadFile по строке на ошибку; копятся и без
+    // приёмника сообщений. Пусто - ошибок не было
+    const std::string &errors() const { return errorText; }
+    // Выражения и результаты последнего файла с несколькими выражениями;
+    // пусто, если в файле одно выражение
+    const ExpressionSet &expressions() const { return work.expressions; }
+    // Файл отображается в память один раз: выражение берётся из первой строки,
+    // операнды - из остальных, без промежуточных копий. Только для файлов с одним выражением
+    bool loadFile(const std::string &fileName,
+                  Program &program,
+                  OperandMap &operands);
+    bool convertToBinaryAndSave(const std::string &txtFileName, const std::string &binFileName);
+    // Проверка без вычисления: один проход по выражению и строкам операндов.
+    // Собирает все ошибки, а не только первую (отсортированы по положению);
+    // деление на ноль не проверяется. true - ошибок нет
+    bool validateFile(const std::string &fileName, std::vector<Diagnostic> &diagnostics);
+    bool validate(std::string_view text, std::vector<Diagnostic> &diagnostics);
+
+    // text - содержимое файла; после вызова в нём остаются строки операндов
+    bool readExpression(std::string_view &text, std::string_view &expression);
+    bool convertToRPN(std::string_view expression, std::string &B, Program &program);
+    bool readOperands(std::string_view text, OperandMap &operands);
+
+    bool evaluate(const Program &program,
+                  const OperandMap &operands,
+                  double *result = nullptr);
+
+    static std::string formatDouble(double value);
+    static std::string formatNumber(double value);
+    // Результат с границей погрешности: все значащие цифры value и 2 цифры bound
+    static std::string formatPrecise(double value, double bound);
+
+private:
+    // Элемент стека convertToRPN: открывающая скобка или операция.
+    // Функция лежит под скобкой своих аргументов
+    struct Pending
+    {
+        char bracket;             // 0 - операция op
+        const Operator *op;
+        std::uint32_t separators; // у скобки: число ';' между аргументами
+        std::uint32_t offset;     // позиция в выражении
+    };
+
+    struct Workspace
+    {
+        std::vector<Pending> operators; // стек операторов convertToRPN
+        std::string echo;            // прочитанная часть выражения для сообщения об ошибке
+        std::string rpn;
+        Program program;
+        std::vector<double> slots;
+        std::vector<std::uint8_t> bound;
+        std::vector<double> stack;
+        std::vector<Diagnostic> errors; // ошибка convertToRPN
+        SymbolTable defined;            // операнды, заданные в проверяемом файле
+        PreciseEvaluator precise;
+        ExpressionSet expressions;
+    };
+
+    bool runFile(const std::string &fileName, double *result);
+    bool runText(std::string_view text, double *result);
+    // Файл с несколькими выражениями: text - всё содержимое файла
+    bool runExpressions(std::string_view text);
+    // Результат или ошибка выражения набора; false - выражение не вычислено
+    bool reportExpression(size_t index);
+    // Разбор выражения в ОПЗ. all = false - остановка на первой ошибке,
+    // true - разбор продолжается после ошибок и собирает их все
+    bool parseExpression(std::string_view expression,
+                         std::string &rpn,
+                         std::vector<Diagnostic> &errors,
+                         bool all);
+    // Ошибки одного выражения (строка 1, столбцы от его начала); операнды - work.defined
+    void validateExpression(std::string_view expression, std::vector<Diagnostic> &diagnostics);
+    // Проверка .bin: файл читается, операнды программы должны быть заданы
+    bool validateCompiled(std::string_view bytes, std::vector<Diagnostic> &diagnostics);
+    bool openFile(MappedFile &file, const std::string &fileName);
+    // convertToRPN с учётом кэша программ; сообщает полученную ОПЗ
+    bool compileExpression(std::string_view expression, std::string &rpn, Program &program);
+    bool loadCompiled(std::string_view bytes, Program &program, OperandMap &operands);
+    void reportListing(const Program &program);
+    // firstLine - номер первой строки text в файле, для сообщений об ошибках
+    template <typename Store>
+    bool readOperandLines(std::string_view text, int firstLine, Store &&store);
+    // Вычисляет по work.slots; непривязанные слоты отмечены нулём в work.bound
+    bool evaluateSlots(const Program &program, double *result);
+    void report(MessageKind kind, std::string_view text);
+    // Сообщение об ошибке с учётом её причины в метриках
+    void fail(ErrorCategory category, std::string_view text);
+    // true - отмена запрошена; заодно сообщает ход обработки
+    bool interrupted(size_t done, size_t total);
+
+    MessageSink sink;
+    LogOptions logOptions;
+    ProgressSink progress;
+    const std::atomic<bool> *cancelFlag = nullptr;
+    EvalCache *cache = nullptr;
+    Metrics *metrics = nullptr;
+    ThreadPool *pool = nullptr;
+    Precision precision = Precision::Double;
+    double bound = 0;
+    std::string errorText;
+    // Имя выражения, которое fail() добавляет к ошибкам его разбора
+    std::string_view errorScope;
+    Workspace work;
+};
+
+#endif // ENGINE_H
@@ -0,0 +1,46 @@
+# Вычислительное ядро без зависимости от Qt: подключается GUI и консольными целями
+INCLUDEPATH += $$PWD
+CONFIG += thread
+# dlopen для собранного машинного кода выражений (native.cpp)
+unix: LIBS += -ldl
+# Замеры этапов Engine (metrics.h) убираются из сборки: DEFINES += NATURE_NO_METRICS
+
+SOURCES += \
+    $$PWD/columns.cpp \
+    $$PWD/compiledfile.cpp \
+    $$PWD/engine.cpp \
+    $$PWD/evalcache.cpp \
+    $$PWD/expressions.cpp \
+    $$PWD/incremental.cpp \
+    $$PWD/kernels.cpp \
+    $$PWD/mappedfile.cpp \
+    $$PWD/metrics.cpp \
+    $$PWD/native.cpp \
+    $$PWD/numparse.cpp \
+    $$PWD/operators.cpp \
+    $$PWD/precise.cpp \
+    $$PWD/program.cpp \
+    $$PWD/server.cpp \
+    $$PWD/stream.cpp \
+    $$PWD/symbols.cpp \
+    $$PWD/threadpool.cpp
+
+HEADERS += \
+    $$PWD/columns.h \
+    $$PWD/compiledfile.h \
+    $$PWD/engine.h \
+    $$PWD/evalcache.h \
+    $$PWD/expressions.h \
+    $$PWD/incremental.h \
+    $$PWD/kernels.h \
+    $$PWD/mappedfile.h \
+    $$PWD/metrics.h \
+    $$PWD/native.h \
+    $$PWD/numparse.h \
+    $$PWD/operators.h \
+    $$PWD/precise.h \
+    $$PWD/program.h \
+    $$PWD/server.h \
+    $$PWD/stream.h \
+    $$PWD/symbols.h \
+    $$PWD/threadpool.h
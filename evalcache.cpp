@@ -0,0 +1,123 @@
+#include "evalcache.h"
+#include <cstring>
+
+namespace {
+
+std::uint64_t hashBytes(const void *data, size_t size, std::uint64_t hash = 14695981039346656037ull)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::uint64_t resultHash(std::string_view expression, const std::vector<double> &slots)
+{
+    std::uint64_t hash = hashBytes(expression.data(), expression.size());
+    return hashBytes(slots.data(), slots.size() * sizeof(double), hash);
+}
+
+// Побитовое сравнение: NaN совпадает с NaN, а 0 и -0 различаются, как и в хэше
+bool sameSlots(const std::vector<double> &a, const std::vector<double> &b)
+{
+    return a.size() == b.size()
+           && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0);
+}
+
+} // namespace
+
+EvalCache::EvalCache(size_t programCapacity, size_t resultCapacity)
+    : programs(programCapacity)
+    , results(resultCapacity)
+{}
+
+void EvalCache::setResultCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    results.setCapacity(capacity, counters.evictions);
+}
+
+void EvalCache::setProgramCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    programs.setCapacity(capacity, counters.evictions);
+}
+
+bool EvalCache::findProgram(std::string_view expression, std::string &rpn, Program &program)
+{
+    std::uint64_t hash = hashBytes(expression.data(), expression.size());
+    std::lock_guard<std::mutex> lock(mutex);
+    ProgramEntry *entry = programs.find(hash);
+    if (!entry || entry->expression != expression) {
+        ++counters.programMisses;
+        return false;
+    }
+    ++counters.programHits;
+    rpn = entry->rpn;
+    program = entry->program;
+    return true;
+}
+
+void EvalCache::storeProgram(std::string_view expression,
+                             const std::string &rpn,
+                             const Program &program)
+{
+    std::uint64_t hash = hashBytes(expression.data(), expression.size());
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ProgramEntry *entry = programs.insert(hash, counters.evictions)) {
+        entry->expression.assign(expression.data(), expression.size());
+        entry->rpn = rpn;
+        entry->program = program;
+    }
+}
+
+bool EvalCache::findResult(std::string_view expression,
+                           const std::vector<double> &slots,
+                           double &value)
+{
+    std::uint64_t hash = resultHash(expression, slots);
+    std::lock_guard<std::mutex> lock(mutex);
+    ResultEntry *entry = results.find(hash);
+    if (!entry || entry->expression != expression || !sameSlots(entry->slots, slots)) {
+        ++counters.resultMisses;
+        return false;
+    }
+    ++counters.resultHits;
+    value = entry->value;
+    return true;
+}
+
+void EvalCache::storeResult(std::string_view expression,
+                            const std::vector<double> &slots,
+                            double value)
+{
+    std::uint64_t hash = resultHash(expression, slots);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ResultEntry *entry = results.insert(hash, counters.evictions)) {
+        entry->expression.assign(expression.data(), expression.size());
+        entry->slots = slots;
+        entry->value = value;
+    }
+}
+
+bool EvalCache::cachesResults() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return results.limit() != 0;
+}
+
+CacheStats EvalCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void EvalCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    programs.clear();
+    results.clear();
+    counters = CacheStats();
+}
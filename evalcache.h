@@ -0,0 +1,131 @@
+#ifndef EVALCACHE_H
+#define EVALCACHE_H
+
+#include "program.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct CacheStats
+{
+    size_t programHits = 0;
+    size_t programMisses = 0;
+    size_t resultHits = 0;
+    size_t resultMisses = 0;
+    size_t evictions = 0;
+};
+
+// Кэш, общий для нескольких Engine (и потоков):
+//  - скомпилированные программы по тексту выражения - повторное выражение
+//    не проходит convertToRPN;
+//  - необязательно: результаты по паре (выражение, значения операндов).
+// Ключ - 64-битный хэш содержимого, при совпадении хэша содержимое сверяется полностью.
+// Оба кэша ограничены по числу записей и вытесняют давно не использованные (LRU)
+class EvalCache
+{
+public:
+    explicit EvalCache(size_t programCapacity = 256, size_t resultCapacity = 0);
+
+    // 0 - кэш результатов выключен
+    void setResultCapacity(size_t capacity);
+    void setProgramCapacity(size_t capacity);
+
+    bool findProgram(std::string_view expression, std::string &rpn, Program &program);
+    void storeProgram(std::string_view expression, const std::string &rpn, const Program &program);
+
+    // slots - значения всех слотов программы, скомпилированной из expression
+    bool findResult(std::string_view expression, const std::vector<double> &slots, double &value);
+    void storeResult(std::string_view expression, const std::vector<double> &slots, double value);
+
+    bool cachesResults() const;
+    CacheStats stats() const;
+    void clear();
+
+private:
+    // Список LRU: начало - самые свежие записи; индекс по хэшу ключа
+    template <typename Entry>
+    class Lru
+    {
+    public:
+        explicit Lru(size_t capacity)
+            : capacity(capacity)
+        {}
+
+        Entry *find(std::uint64_t hash)
+        {
+            auto it = index.find(hash);
+            if (it == index.end())
+                return nullptr;
+            entries.splice(entries.begin(), entries, it->second);
+            return &entries.front();
+        }
+
+        // Запись для hash, новая или существующая; nullptr - если кэш выключен
+        Entry *insert(std::uint64_t hash, size_t &evictions)
+        {
+            if (capacity == 0)
+                return nullptr;
+            if (Entry *entry = find(hash))
+                return entry;
+            while (entries.size() >= capacity) {
+                index.erase(entries.back().hash);
+                entries.pop_back();
+                ++evictions;
+            }
+            entries.emplace_front();
+            entries.front().hash = hash;
+            index[hash] = entries.begin();
+            return &entries.front();
+        }
+
+        void setCapacity(size_t value, size_t &evictions)
+        {
+            capacity = value;
+            while (entries.size() > capacity) {
+                index.erase(entries.back().hash);
+                entries.pop_back();
+                ++evictions;
+            }
+        }
+
+        size_t limit() const { return capacity; }
+
+        void clear()
+        {
+            entries.clear();
+            index.clear();
+        }
+
+    private:
+        size_t capacity;
+        std::list<Entry> entries;
+        std::unordered_map<std::uint64_t, typename std::list<Entry>::iterator> index;
+    };
+
+    struct ProgramEntry
+    {
+        std::uint64_t hash = 0;
+        std::string expression;
+        std::string rpn;
+        Program program;
+    };
+
+    struct ResultEntry
+    {
+        std::uint64_t hash = 0;
+        std::string expression;
+        std::vector<double> slots;
+        double value = 0;
+    };
+
+    mutable std::mutex mutex;
+    Lru<ProgramEntry> programs;
+    Lru<ResultEntry> results;
+    CacheStats counters;
+};
+
+#endif // EVALCACHE_H
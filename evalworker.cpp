@@ -0,0 +1,79 @@
+#include "evalworker.h"
+
+EvalWorker::EvalWorker(QObject *parent)
+    : QObject(parent)
+    , engine([this](MessageKind kind, const std::string &text) { collect(kind, text); })
+{
+    qRegisterMetaType<EvalMessage>();
+    qRegisterMetaType<QVector<EvalMessage>>();
+
+    engine.setCache(&cache);
+    engine.setMetrics(&metrics);
+    engine.setProgress([this](size_t done, size_t total) { reportProgress(done, total); });
+    engine.setCancelFlag(&cancelRequested);
+}
+
+void EvalWorker::cancel()
+{
+    cancelRequested.store(true, std::memory_order_relaxed);
+}
+
+void EvalWorker::process(const QString &fileName, bool steps)
+{
+    LogOptions options;
+    options.steps = steps;
+    options.maxOperands = MaxLoggedOperands;
+    options.maxSteps = MaxLoggedSteps;
+    engine.setLogOptions(options);
+
+    cancelRequested.store(false, std::memory_order_relaxed);
+    lastPermille = -1;
+    sinceFlush.start();
+    sinceProgress.start();
+    emit progress(0);
+
+    bool ok = engine.processFile(fileName.toStdString());
+
+    flush();
+    emit progress(1000);
+    emit processed(ok, cancelRequested.load(std::memory_order_relaxed));
+}
+
+void EvalWorker::convert(const QString &txtFileName, const QString &binFileName)
+{
+    cancelRequested.store(false, std::memory_order_relaxed);
+    sinceFlush.start();
+    sinceProgress.start();
+    bool ok = engine.convertToBinaryAndSave(txtFileName.toStdString(), binFileName.toStdString());
+    flush();
+    emit converted(ok, binFileName);
+}
+
+void EvalWorker::collect(MessageKind kind, const std::string &text)
+{
+    pending.append(EvalMessage{kind, QString::fromStdString(text)});
+    if (sinceFlush.elapsed() >= FlushIntervalMs)
+        flush();
+}
+
+void EvalWorker::reportProgress(size_t done, size_t total)
+{
+    int permille = total ? static_cast<int>(done * 1000 / total) : 1000;
+    if (permille == lastPermille || sinceProgress.elapsed() < FlushIntervalMs)
+        return;
+    lastPermille = permille;
+    sinceProgress.restart();
+    emit progress(permille);
+    // Сообщения, накопленные до этого места, тоже не ждут конца обработки
+    if (sinceFlush.elapsed() >= FlushIntervalMs)
+        flush();
+}
+
+void EvalWorker::flush()
+{
+    sinceFlush.restart();
+    if (pending.isEmpty())
+        return;
+    emit messages(pending);
+    pending.clear();
+}
@@ -0,0 +1,72 @@
+#ifndef EVALWORKER_H
+#define EVALWORKER_H
+
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "engine.h"
+#include "evalcache.h"
+#include "metrics.h"
+
+struct EvalMessage
+{
+    MessageKind kind;
+    QString text;
+};
+
+Q_DECLARE_METATYPE(EvalMessage)
+Q_DECLARE_METATYPE(QVector<EvalMessage>)
+
+// Обработка файлов в отдельном потоке (объект переносится в QThread).
+// Сообщения Engine копятся и уходят в GUI пачками не чаще раза в кадр,
+// чтобы окно не перерисовывалось на каждый операнд и шаг вычисления
+class EvalWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EvalWorker(QObject *parent = nullptr);
+
+    // Вызывается напрямую из GUI-потока: задача в этот момент занимает поток исполнителя
+    void cancel();
+    // Счётчики атомарные, поэтому снимок читается из GUI-потока во время обработки
+    const Metrics &stats() const { return metrics; }
+
+public slots:
+    // steps - показывать шаги расчета (их число всё равно ограничено)
+    void process(const QString &fileName, bool steps);
+    void convert(const QString &txtFileName, const QString &binFileName);
+
+signals:
+    void messages(const QVector<EvalMessage> &batch);
+    // permille - доля выполненной работы, 0..1000
+    void progress(int permille);
+    void processed(bool ok, bool cancelled);
+    void converted(bool ok, const QString &binFileName);
+
+private:
+    void collect(MessageKind kind, const std::string &text);
+    void reportProgress(size_t done, size_t total);
+    void flush();
+
+    // Пачка сообщений отправляется не чаще раза в кадр (60 fps)
+    static constexpr qint64 FlushIntervalMs = 16;
+    // Больше строк окну всё равно не показать с пользой
+    static constexpr size_t MaxLoggedOperands = 10000;
+    static constexpr size_t MaxLoggedSteps = 10000;
+
+    std::atomic<bool> cancelRequested{false};
+    QVector<EvalMessage> pending;
+    QElapsedTimer sinceFlush;
+    QElapsedTimer sinceProgress;
+    int lastPermille = -1;
+    // Повторный запуск того же выражения не проходит convertToRPN заново
+    EvalCache cache;
+    Metrics metrics;
+    Engine engine;
+};
+
+#endif // EVALWORKER_H
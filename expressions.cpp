@@ -0,0 +1,181 @@
+#include "expressions.h"
+#include "operators.h"
+#include "threadpool.h"
+#include <algorithm>
+
+namespace {
+
+std::string_view trimmed(std::string_view text)
+{
+    const size_t start = text.find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+        return std::string_view();
+    return text.substr(start, text.find_last_not_of(" \t") - start + 1);
+}
+
+} // namespace
+
+bool ExpressionSet::splitLine(std::string_view line,
+                              std::string_view &name,
+                              std::string_view &expression)
+{
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos)
+        return false;
+    if (colon + 1 < line.size() && line[colon + 1] != ' ' && line[colon + 1] != '\t')
+        return false;
+    name = trimmed(line.substr(0, colon));
+    expression = trimmed(line.substr(colon + 1));
+    return !name.empty();
+}
+
+void ExpressionSet::clear()
+{
+    count = 0;
+    index.clear();
+    operands.clear();
+}
+
+Program *ExpressionSet::add(std::string_view name)
+{
+    if (index.find(name) >= 0)
+        return nullptr;
+    index.intern(name);
+    if (count == names.size()) {
+        names.emplace_back();
+        programs.emplace_back();
+        compiled.push_back(0);
+        results.emplace_back();
+    }
+    names[count].assign(name.data(), name.size());
+    compiled[count] = 1;
+    results[count] = ExpressionResult();
+    return &programs[count++];
+}
+
+void ExpressionSet::bindOperands()
+{
+    operands.clear();
+    operandOf.clear();
+    slotStart.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        slotStart[i] = operandOf.size();
+        if (!compiled[i])
+            continue;
+        const Program &program = programs[i];
+        for (size_t slot = 0; slot < program.variableCount(); ++slot)
+            operandOf.push_back(operands.intern(program.variableName(slot)));
+    }
+    values.assign(operands.size(), 0);
+    defined.assign(operands.size(), 0);
+}
+
+void ExpressionSet::setOperand(std::string_view name, double value)
+{
+    const int id = operands.find(name);
+    if (id >= 0) {
+        values[id] = value;
+        defined[id] = 1;
+    }
+}
+
+void ExpressionSet::evaluate(Precision precision, ThreadPool *pool)
+{
+    const size_t workers = pool ? pool->threadCount() : 1;
+    if (scratch.size() < workers)
+        scratch.resize(workers);
+
+    if (!pool || workers == 1 || count <= TaskExpressions) {
+        for (size_t i = 0; i < count; ++i)
+            evaluateOne(i, precision, scratch[0]);
+        return;
+    }
+    const size_t tasks = (count + TaskExpressions - 1) / TaskExpressions;
+    pool->run(tasks, [&](size_t task, size_t worker) {
+        const size_t end = std::min(count, (task + 1) * TaskExpressions);
+        for (size_t i = task * TaskExpressions; i < end; ++i)
+            evaluateOne(i, precision, scratch[worker]);
+    });
+}
+
+void ExpressionSet::evaluateOne(size_t index, Precision precision, Scratch &scratch)
+{
+    ExpressionResult &result = results[index];
+    result = ExpressionResult();
+    if (!compiled[index])
+        return;
+
+    const Program &program = programs[index];
+    const std::uint32_t *slotOperands = operandOf.data() + slotStart[index];
+    std::vector<double> &slots = scratch.slots;
+    slots.resize(program.variableCount());
+    bool complete = program.isWellFormed();
+    for (size_t slot = 0; slot < slots.size(); ++slot) {
+        slots[slot] = values[slotOperands[slot]];
+        complete = complete && defined[slotOperands[slot]];
+    }
+
+    // Не все операнды определены (или программа некорректна): команды выполняются
+    // по порядку до первой ошибки, как в подробном журнале Engine. Поэтому в 1/0+y
+    // сообщается деление на ноль, а не неопределённый y. Без ошибки по ходу итог -
+    // Malformed: стек в конце не из одного значения
+    if (!complete) {
+        std::vector<double> &stack = scratch.stack;
+        const size_t steps = program.code().size();
+        stack.resize(steps + program.tempCount() + 1);
+        double *temp = stack.data() + steps + 1;
+        size_t depth = 0;
+        for (const Instruction &ins : program.code()) {
+            switch (ins.op) {
+            case OpCode::Constant:
+                stack[depth++] = program.constant(ins.arg);
+                break;
+            case OpCode::Variable:
+                if (!defined[slotOperands[ins.arg]]) {
+                    result.undefined = static_cast<int>(ins.arg);
+                    return;
+                }
+                stack[depth++] = slots[ins.arg];
+                break;
+            case OpCode::BadNumber:
+                result.status = EvalStatus::BadNumber;
+                return;
+            case OpCode::Store:
+                if (depth < 1)
+                    return;
+                temp[ins.arg] = stack[depth - 1];
+                break;
+            case OpCode::Load:
+                stack[depth++] = temp[ins.arg];
+                break;
+            default: {
+                const size_t operands = static_cast<size_t>(arity(ins.op));
+                if (depth < operands)
+                    return;
+                if (operands == 1) {
+                    stack[depth - 1] = applyUnary(ins.op, stack[depth - 1]);
+                    break;
+                }
+                const double b = stack[--depth];
+                if (ins.op == OpCode::Divide && b == 0) {
+                    result.status = EvalStatus::DivisionByZero;
+                    return;
+                }
+                stack[depth - 1] = applyBinary(ins.op, stack[depth - 1], b);
+                break;
+            }
+            }
+        }
+        return;
+    }
+
+    if (precision != Precision::Double) {
+        PreciseResult precise;
+        result.status = scratch.precise.evaluate(program, slots.data(), precision, precise);
+        result.value = precise.value;
+        result.bound = precise.bound;
+        return;
+    }
+    scratch.stack.resize(program.frameSize() + 1);
+    result.status = program.evaluate(slots.data(), scratch.stack.data(), result.value);
+}
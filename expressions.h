@@ -0,0 +1,96 @@
+#ifndef EXPRESSIONS_H
+#define EXPRESSIONS_H
+
+#include "precise.h"
+#include "program.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+// Итог вычисления одного выражения набора; до вычисления status = Malformed
+struct ExpressionResult
+{
+    EvalStatus status = EvalStatus::Malformed;
+    int undefined = -1; // слот неопределённого операнда (тогда status не Ok)
+    double value = 0;
+    double bound = 0;   // граница погрешности в режимах Interval и Compensated
+};
+
+// Несколько именованных выражений над общими операндами. Файл такого вида:
+//     площадь: a*b
+//     периметр: 2*(a+b)
+//
+//     a = 3
+//     b = 4
+// Выражения - подряд с первой строки, имя отделено ':' и пробелом (в прежнем формате
+// такая строка не вычисляется: ':' - часть имени операнда, а пробел его заканчивает).
+// Имена операндов всех выражений сводятся в одну таблицу, поэтому строки операндов
+// разбираются один раз на все выражения. Память сохраняется между clear()
+class ExpressionSet
+{
+public:
+    // Выражений на задачу пула: вычисление одного выражения слишком короткое
+    static constexpr size_t TaskExpressions = 16;
+
+    // true - строка задаёт именованное выражение: name и expression без пробелов по краям
+    static bool splitLine(std::string_view line,
+                          std::string_view &name,
+                          std::string_view &expression);
+
+    void clear();
+    // Новое выражение; программу компилирует вызывающий до следующего add().
+    // Повторное имя - nullptr
+    Program *add(std::string_view name);
+    // Выражение не скомпилировано (ошибка уже сообщена) и не вычисляется
+    void markFailed(size_t index) { compiled[index] = 0; }
+
+    // После добавления всех выражений: общая таблица операндов
+    void bindOperands();
+    // Значение операнда; операнды, не нужные ни одному выражению, пропускаются
+    void setOperand(std::string_view name, double value);
+
+    // Вычисляет все скомпилированные выражения; pool - параллельно, nullptr -
+    // в вызывающем потоке. Результат не зависит от числа потоков
+    void evaluate(Precision precision, ThreadPool *pool);
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const std::string &name(size_t index) const { return names[index]; }
+    const Program &program(size_t index) const { return programs[index]; }
+    bool isCompiled(size_t index) const { return compiled[index] != 0; }
+    const ExpressionResult &result(size_t index) const { return results[index]; }
+    size_t operandCount() const { return operands.size(); }
+
+private:
+    // Рабочая память одного исполнителя пула
+    struct Scratch
+    {
+        std::vector<double> slots;
+        std::vector<double> stack;
+        PreciseEvaluator precise;
+    };
+
+    void evaluateOne(size_t index, Precision precision, Scratch &scratch);
+
+    // Векторы не укорачиваются: программы и имена переиспользуются следующим файлом
+    size_t count = 0;
+    std::vector<std::string> names;
+    std::vector<Program> programs;
+    std::vector<std::uint8_t> compiled;
+    std::vector<ExpressionResult> results;
+    SymbolTable index; // имена выражений
+
+    // Общая таблица операндов и слоты выражения i: operandOf[slotStart[i] + слот]
+    SymbolTable operands;
+    std::vector<double> values;
+    std::vector<std::uint8_t> defined;
+    std::vector<std::uint32_t> operandOf;
+    std::vector<size_t> slotStart;
+
+    std::vector<Scratch> scratch;
+};
+
+#endif // EXPRESSIONS_H
@@ -0,0 +1,179 @@
+#include "incremental.h"
+#include "operators.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+bool sameBits(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+} // namespace
+
+bool IncrementalEvaluator::reset(const Program &program, const double *slots)
+{
+    nodes.clear();
+    if (!program.isWellFormed())
+        return false;
+
+    // Узлы создаются в порядке кода, поэтому операнды узла всегда имеют меньший номер
+    constants.assign(program.constantCount(), 0);
+    for (size_t i = 0; i < constants.size(); ++i)
+        constants[i] = program.constant(static_cast<std::uint32_t>(i));
+    std::vector<std::uint32_t> stack;
+    std::vector<std::uint32_t> temps(program.tempCount());
+    for (const Instruction &ins : program.code()) {
+        switch (ins.op) {
+        case OpCode::Constant:
+        case OpCode::Variable:
+            nodes.push_back({ins.op, ins.arg, 0});
+            break;
+        case OpCode::Store:
+            temps[ins.arg] = stack.back();
+            continue;
+        case OpCode::Load:
+            stack.push_back(temps[ins.arg]);
+            continue;
+        default: {
+            if (arity(ins.op) == 1) {
+                nodes.push_back({ins.op, stack.back(), 0});
+                stack.pop_back();
+                break;
+            }
+            std::uint32_t right = stack.back();
+            stack.pop_back();
+            std::uint32_t left = stack.back();
+            stack.pop_back();
+            nodes.push_back({ins.op, left, right});
+            break;
+        }
+        }
+        stack.push_back(static_cast<std::uint32_t>(nodes.size() - 1));
+    }
+    root = stack.back();
+
+    // Потребители узлов и узлы операндов по слотам
+    parentStart.assign(nodes.size() + 1, 0);
+    useStart.assign(program.variableCount() + 1, 0);
+    for (const Node &node : nodes) {
+        if (node.op == OpCode::Variable) {
+            ++useStart[node.left + 1];
+        } else if (arity(node.op) == 1) {
+            ++parentStart[node.left + 1];
+        } else if (node.op != OpCode::Constant) {
+            ++parentStart[node.left + 1];
+            ++parentStart[node.right + 1];
+        }
+    }
+    for (size_t i = 1; i < parentStart.size(); ++i)
+        parentStart[i] += parentStart[i - 1];
+    for (size_t i = 1; i < useStart.size(); ++i)
+        useStart[i] += useStart[i - 1];
+    parents.resize(parentStart.back());
+    uses.resize(useStart.back());
+    std::vector<std::uint32_t> fill(parentStart.begin(), parentStart.end() - 1);
+    std::vector<std::uint32_t> useFill(useStart.begin(), useStart.end() - 1);
+    for (std::uint32_t i = 0; i < nodes.size(); ++i) {
+        const Node &node = nodes[i];
+        if (node.op == OpCode::Variable) {
+            uses[useFill[node.left]++] = i;
+        } else if (arity(node.op) == 1) {
+            parents[fill[node.left]++] = i;
+        } else if (node.op != OpCode::Constant) {
+            parents[fill[node.left]++] = i;
+            parents[fill[node.right]++] = i;
+        }
+    }
+
+    changedSlots.clear();
+    slotValues.assign(slots, slots + program.variableCount());
+    values.assign(nodes.size(), 0);
+    failed.assign(nodes.size(), 0);
+    queued.assign(nodes.size(), 0);
+    failures = 0;
+    for (std::uint32_t i = 0; i < nodes.size(); ++i)
+        compute(i);
+    recomputed = nodes.size();
+    return true;
+}
+
+void IncrementalEvaluator::setOperand(size_t slot, double value)
+{
+    if (slot >= slotValues.size() || sameBits(slotValues[slot], value))
+        return;
+    slotValues[slot] = value;
+    changedSlots.push_back(static_cast<std::uint32_t>(slot));
+}
+
+EvalStatus IncrementalEvaluator::update(double &result)
+{
+    if (nodes.empty())
+        return EvalStatus::Malformed;
+
+    // Мин-куча по номеру узла: узел пересчитывается после всех своих изменённых операндов
+    recomputed = 0;
+    heap.clear();
+    auto enqueue = [this](std::uint32_t index) {
+        if (!queued[index]) {
+            queued[index] = 1;
+            heap.push_back(index);
+            std::push_heap(heap.begin(), heap.end(), std::greater<>());
+        }
+    };
+    for (std::uint32_t slot : changedSlots) {
+        for (std::uint32_t i = useStart[slot]; i < useStart[slot + 1]; ++i)
+            enqueue(uses[i]);
+    }
+    changedSlots.clear();
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+        std::uint32_t index = heap.back();
+        heap.pop_back();
+        queued[index] = 0;
+        ++recomputed;
+        if (compute(index)) {
+            for (std::uint32_t i = parentStart[index]; i < parentStart[index + 1]; ++i)
+                enqueue(parents[i]);
+        }
+    }
+
+    if (failures != 0)
+        return EvalStatus::DivisionByZero;
+    result = values[root];
+    return EvalStatus::Ok;
+}
+
+bool IncrementalEvaluator::compute(std::uint32_t index)
+{
+    const Node &node = nodes[index];
+    double value = 0;
+    std::uint8_t zero = 0;
+    switch (node.op) {
+    case OpCode::Constant:
+        value = constants[node.left];
+        break;
+    case OpCode::Variable:
+        value = slotValues[node.left];
+        break;
+    case OpCode::Divide:
+        // Деление на ноль - ошибка всего вычисления, пока делитель не изменится
+        zero = values[node.right] == 0;
+        value = values[node.left] / values[node.right];
+        break;
+    default:
+        value = arity(node.op) == 1 ? applyUnary(node.op, values[node.left])
+                                    : applyBinary(node.op, values[node.left], values[node.right]);
+        break;
+    }
+
+    bool changed = !sameBits(values[index], value) || failed[index] != zero;
+    failures += zero;
+    failures -= failed[index];
+    values[index] = value;
+    failed[index] = zero;
+    return changed;
+}
@@ -0,0 +1,61 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "program.h"
+#include <cstdint>
+#include <vector>
+
+// Повторное вычисление после изменения части операндов.
+// Хранит граф зависимостей программы (с учётом общих подвыражений Store/Load)
+// и значения всех промежуточных узлов с прошлого вычисления. update() пересчитывает
+// только узлы, зависящие от изменённых операндов, в порядке кода; распространение
+// останавливается на узле, значение которого не изменилось.
+// Результат побитово совпадает с Program::evaluate по тем же операндам
+class IncrementalEvaluator
+{
+public:
+    // Полное вычисление. program должна быть isWellFormed(), slots - значения
+    // всех её операндов. false - программа не годится для пересчёта
+    bool reset(const Program &program, const double *slots);
+
+    size_t operandCount() const { return slotValues.size(); }
+    // Новое значение операнда; пересчёт откладывается до update()
+    void setOperand(size_t slot, double value);
+    EvalStatus update(double &result);
+
+    size_t nodeCount() const { return nodes.size(); }
+    // Сколько узлов пересчитал последний reset() или update()
+    size_t recomputedCount() const { return recomputed; }
+
+private:
+    struct Node
+    {
+        OpCode op;
+        std::uint32_t left;  // Variable - слот, Constant - индекс константы, иначе - узел
+        std::uint32_t right; // второй операнд двуместной операции
+    };
+
+    // true - значение узла или признак деления на ноль изменились
+    bool compute(std::uint32_t index);
+
+    std::vector<Node> nodes;
+    std::vector<double> constants;
+    std::vector<double> values;
+    std::vector<std::uint8_t> failed; // деление на ноль в этом узле
+    size_t failures = 0;
+    std::uint32_t root = 0;
+
+    // Списки смежности в сжатом виде: потребители узла и узлы-операнды слота
+    std::vector<std::uint32_t> parentStart;
+    std::vector<std::uint32_t> parents;
+    std::vector<std::uint32_t> useStart;
+    std::vector<std::uint32_t> uses;
+
+    std::vector<double> slotValues;
+    std::vector<std::uint32_t> changedSlots;
+    std::vector<std::uint8_t> queued;
+    std::vector<std::uint32_t> heap;
+    size_t recomputed = 0;
+};
+
+#endif // INCREMENTAL_H
@@ -0,0 +1,132 @@
+#include "kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NATURE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void addScalar(const double *a, const double *b, double *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = a[i] + b[i];
+}
+
+void subtractScalar(const double *a, const double *b, double *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = a[i] - b[i];
+}
+
+void multiplyScalar(const double *a, const double *b, double *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = a[i] * b[i];
+}
+
+bool divideScalar(const double *a, const double *b, double *out, size_t n)
+{
+    bool zero = false;
+    for (size_t i = 0; i < n; ++i) {
+        zero |= b[i] == 0;
+        out[i] = a[i] / b[i];
+    }
+    return zero;
+}
+
+#ifdef NATURE_X86
+
+// Хвост блока, не кратный ширине вектора, досчитывается скалярно
+#define NATURE_BINARY_KERNEL(name, isa, type, width, load, store, op, scalarOp) \
+    __attribute__((target(isa))) void name(const double *a, \
+                                              const double *b, \
+                                              double *out, \
+                                              size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + width <= n; i += width) { \
+            type va = load(a + i); \
+            type vb = load(b + i); \
+            store(out + i, op(va, vb)); \
+        } \
+        for (; i < n; ++i) \
+            out[i] = a[i] scalarOp b[i]; \
+    }
+
+NATURE_BINARY_KERNEL(addSse2, "sse2", __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd, +)
+NATURE_BINARY_KERNEL(subtractSse2, "sse2", __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_sub_pd, -)
+NATURE_BINARY_KERNEL(multiplySse2, "sse2", __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd, *)
+NATURE_BINARY_KERNEL(addAvx2, "avx2", __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, +)
+NATURE_BINARY_KERNEL(subtractAvx2, "avx2", __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd, -)
+NATURE_BINARY_KERNEL(multiplyAvx2, "avx2", __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd, *)
+
+#undef NATURE_BINARY_KERNEL
+
+__attribute__((target("sse2"))) bool divideSse2(const double *a, const double *b, double *out, size_t n)
+{
+    __m128d zero = _mm_setzero_pd();
+    __m128d hits = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d vb = _mm_loadu_pd(b + i);
+        hits = _mm_or_pd(hits, _mm_cmpeq_pd(vb, zero));
+        _mm_storeu_pd(out + i, _mm_div_pd(_mm_loadu_pd(a + i), vb));
+    }
+    bool found = _mm_movemask_pd(hits) != 0;
+    for (; i < n; ++i) {
+        found |= b[i] == 0;
+        out[i] = a[i] / b[i];
+    }
+    return found;
+}
+
+__attribute__((target("avx2"))) bool divideAvx2(const double *a, const double *b, double *out, size_t n)
+{
+    __m256d zero = _mm256_setzero_pd();
+    __m256d hits = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d vb = _mm256_loadu_pd(b + i);
+        hits = _mm256_or_pd(hits, _mm256_cmp_pd(vb, zero, _CMP_EQ_OQ));
+        _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(a + i), vb));
+    }
+    bool found = _mm256_movemask_pd(hits) != 0;
+    for (; i < n; ++i) {
+        found |= b[i] == 0;
+        out[i] = a[i] / b[i];
+    }
+    return found;
+}
+
+const KernelSet sse2Set = {"sse2", addSse2, subtractSse2, multiplySse2, divideSse2};
+const KernelSet avx2Set = {"avx2", addAvx2, subtractAvx2, multiplyAvx2, divideAvx2};
+
+#endif // NATURE_X86
+
+const KernelSet scalarSet = {"scalar", addScalar, subtractScalar, multiplyScalar, divideScalar};
+
+const KernelSet &detectKernels()
+{
+#ifdef NATURE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return avx2Set;
+    if (__builtin_cpu_supports("sse2"))
+        return sse2Set;
+#endif
+    return scalarSet;
+}
+
+} // namespace
+
+const KernelSet &scalarKernels()
+{
+    return scalarSet;
+}
+
+const KernelSet &bestKernels()
+{
+    static const KernelSet &kernels = detectKernels();
+    return kernels;
+}
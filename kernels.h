@@ -0,0 +1,21 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+
+// Поэлементные операции над блоками столбцов: out[i] = a[i] op b[i].
+// out может совпадать с a или b. Деление возвращает true, если в b встретился ноль
+struct KernelSet
+{
+    const char *name;
+    void (*add)(const double *a, const double *b, double *out, size_t n);
+    void (*subtract)(const double *a, const double *b, double *out, size_t n);
+    void (*multiply)(const double *a, const double *b, double *out, size_t n);
+    bool (*divide)(const double *a, const double *b, double *out, size_t n);
+};
+
+const KernelSet &scalarKernels();
+// Лучший набор для текущего процессора (AVX2, SSE2 или скалярный)
+const KernelSet &bestKernels();
+
+#endif // KERNELS_H
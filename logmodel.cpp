@@ -0,0 +1,101 @@
+#include "logmodel.h"
+#include <QBrush>
+#include <QColor>
+
+namespace {
+
+QColor kindColor(MessageKind kind)
+{
+    switch (kind) {
+    case MessageKind::Info:
+        return Qt::cyan;
+    case MessageKind::Text:
+        return Qt::white;
+    case MessageKind::Note:
+        return Qt::blue;
+    case MessageKind::Success:
+        return Qt::darkGreen;
+    case MessageKind::Error:
+        return Qt::red;
+    }
+    return Qt::black;
+}
+
+} // namespace
+
+LogModel::LogModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent)
+    , capacity(capacity > 0 ? capacity : 1)
+{}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : count;
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= count)
+        return QVariant();
+    const Line &entry = line(index.row());
+    if (role == Qt::DisplayRole)
+        return entry.text;
+    if (role == Qt::ForegroundRole)
+        return QBrush(kindColor(entry.kind));
+    return QVariant();
+}
+
+void LogModel::append(MessageKind kind, const QString &text)
+{
+    append(QVector<EvalMessage>{EvalMessage{kind, text}});
+}
+
+void LogModel::append(const QVector<EvalMessage> &batch)
+{
+    incoming.clear();
+    for (const EvalMessage &message : batch) {
+        for (const QString &text : message.text.split('\n'))
+            incoming.append(Line{message.kind, text});
+    }
+    if (incoming.isEmpty())
+        return;
+
+    // Пачка больше буфера: от неё остаётся только хвост, модель строится заново
+    if (incoming.size() >= capacity) {
+        beginResetModel();
+        lines = incoming.mid(incoming.size() - capacity);
+        head = 0;
+        count = capacity;
+        endResetModel();
+        return;
+    }
+
+    int overflow = count + incoming.size() - capacity;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        head = (head + overflow) % capacity;
+        count -= overflow;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), count, count + incoming.size() - 1);
+    for (const Line &entry : incoming) {
+        int slot = (head + count) % capacity;
+        // Пока буфер не заполнен, head == 0 и строки дописываются в конец
+        if (slot == lines.size())
+            lines.append(entry);
+        else
+            lines[slot] = entry;
+        ++count;
+    }
+    endInsertRows();
+}
+
+void LogModel::clear()
+{
+    beginResetModel();
+    lines.clear();
+    head = 0;
+    count = 0;
+    endResetModel();
+}
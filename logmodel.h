@@ -0,0 +1,43 @@
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+#include "evalworker.h"
+
+// Журнал окна: кольцевой буфер строк фиксированной ёмкости.
+// Сообщения режутся на строки, поэтому все строки одной высоты и QListView
+// с uniformItemSizes рисует только видимую часть. При переполнении
+// вытесняются самые старые строки, память ограничена capacity
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit LogModel(int capacity = 100000, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void append(MessageKind kind, const QString &text);
+    void append(const QVector<EvalMessage> &batch);
+    void clear();
+
+private:
+    struct Line
+    {
+        MessageKind kind;
+        QString text;
+    };
+
+    const Line &line(int row) const { return lines[(head + row) % capacity]; }
+
+    int capacity;
+    int head = 0; // индекс самой старой строки
+    int count = 0;
+    QVector<Line> lines;
+    QVector<Line> incoming;
+};
+
+#endif // LOGMODEL_H
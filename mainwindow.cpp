@@ -1,35 +1,53 @@
 #include "mainwindow.h"
+#include <QDialog>
+#include <QDialogButtonBox>
 #include <QFileDialog>
+#include <QFontDatabase>
 #include <QHBoxLayout>
 #include <QMessageBox>
+#include <QPlainTextEdit>
 #include <QVBoxLayout>
-#include <algorithm>
-#include <cctype>
-#include <fstream>
-#include <sstream>
 #include <QFileInfo>
+#include <QScrollBar>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
+    , worker(new EvalWorker)
 {
     setWindowTitle("NatureGroupКЮВ");
     resize(800, 600);
 
-    // Виджеты
-    textEdit = new QTextEdit(this);
-    textEdit->setReadOnly(true);
+    // Виджеты. Журнал виртуализирован: строки одной высоты, рисуется только видимая часть
+    logModel = new LogModel(100000, this);
+    logView = new QListView(this);
+    logView->setModel(logModel);
+    logView->setUniformItemSizes(true);
+    logView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    logView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    stepsBox = new QCheckBox("Шаги расчета", this);
     runButton = new QPushButton("Run Program", this);
+    cancelButton = new QPushButton("Cancel", this);
+    cancelButton->setEnabled(false);
     aboutButton = new QPushButton("About", this);
+    statsButton = new QPushButton("Stats", this);
     openButton = new QPushButton("Open File", this);
     clearButton = new QPushButton("Clear Output", this);
+    progressBar = new QProgressBar(this);
+    progressBar->setRange(0, 1000);
+    progressBar->setTextVisible(false);
+    progressBar->hide();
 
     QWidget *centralWidget = new QWidget(this);
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
-    mainLayout->addWidget(textEdit);
+    mainLayout->addWidget(logView);
+    mainLayout->addWidget(progressBar);
 
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     buttonLayout->addWidget(openButton);
     buttonLayout->addWidget(runButton);
+    buttonLayout->addWidget(cancelButton);
+    buttonLayout->addWidget(stepsBox);
+    buttonLayout->addWidget(statsButton);
     buttonLayout->addWidget(aboutButton);
     buttonLayout->addWidget(clearButton);
     mainLayout->addLayout(buttonLayout);
@@ -37,18 +55,59 @@ MainWindow::MainWindow(QWidget *parent)
     setCentralWidget(centralWidget);
 
     connect(runButton, &QPushButton::clicked, this, &MainWindow::runProgram);
+    connect(cancelButton, &QPushButton::clicked, this, &MainWindow::cancelProgram);
     connect(aboutButton, &QPushButton::clicked, this, &MainWindow::showAbout);
+    connect(statsButton, &QPushButton::clicked, this, &MainWindow::showStats);
     connect(openButton, &QPushButton::clicked, this, &MainWindow::openFile);
     connect(clearButton, &QPushButton::clicked, this, &MainWindow::clearOutput);
 
-    appendToOutput("Все готово к запуску", "cyan");
+    // Исполнитель живёт в своём потоке; запросы и результаты идут через очередь сигналов
+    worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &MainWindow::processRequested, worker, &EvalWorker::process);
+    connect(this, &MainWindow::convertRequested, worker, &EvalWorker::convert);
+    connect(worker, &EvalWorker::messages, this, &MainWindow::appendMessages);
+    connect(worker, &EvalWorker::progress, progressBar, &QProgressBar::setValue);
+    connect(worker, &EvalWorker::processed, this, &MainWindow::programFinished);
+    connect(worker, &EvalWorker::converted, this, &MainWindow::fileConverted);
+    workerThread.start();
+
+    appendToOutput(MessageKind::Info, "Все готово к запуску");
     appendToOutput(
-        "Нажмите 'Open File' чтобы выбрать файл и 'Run Program' чтобы начать его обработку", "cyan");
+        MessageKind::Info,
+        "Нажмите 'Open File' чтобы выбрать файл и 'Run Program' чтобы начать его обработку");
 }
 
-void MainWindow::appendToOutput(const QString &text, const QString &color)
+MainWindow::~MainWindow()
 {
-    textEdit->append(QString("<span style='color:%1;'>%2</span>").arg(color).arg(text));
+    worker->cancel();
+    workerThread.quit();
+    workerThread.wait();
+}
+
+void MainWindow::appendToOutput(MessageKind kind, const QString &text)
+{
+    appendMessages(QVector<EvalMessage>{EvalMessage{kind, text}});
+}
+
+void MainWindow::appendMessages(const QVector<EvalMessage> &batch)
+{
+    // Прокрутка следует за журналом, только если пользователь не листает его выше
+    QScrollBar *bar = logView->verticalScrollBar();
+    bool atBottom = bar->value() == bar->maximum();
+    logModel->append(batch);
+    if (atBottom)
+        logView->scrollToBottom();
+}
+
+void MainWindow::setBusy(bool busy)
+{
+    runButton->setEnabled(!busy);
+    openButton->setEnabled(!busy);
+    cancelButton->setEnabled(busy);
+    progressBar->setVisible(busy);
+    if (busy)
+        progressBar->setValue(0);
 }
 
 void MainWindow::showAbout()
@@ -60,13 +119,47 @@ void MainWindow::showAbout()
                         "- Первая строка: выражение\n"
                         "- Последующие строки: определения операндов (имя = значение)\n"
                         "- Имена операндов не могут быть числами и не должны содержать '='\n\n"
-                        "Поддерживаемые операции: +, -, *, /\n"
+                        "Поддерживаемые операции: +, -, *, /, ^, <, <=, >, >=, ==, !=\n"
+                        "Функции: sqrt, abs, exp, log, min(a; b), max(a; b);\n"
+                        "их имена не могут быть именами операндов\n"
                         "Поддерживаемые скобки: (), [], {}";
 
     QMessageBox::information(this, "About Program", aboutText);
 }
 
-
+// Снимок метрик на момент открытия; сохраняется в JSON или текст Prometheus
+void MainWindow::showStats()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("Статистика обработки");
+    dialog.resize(560, 420);
+
+    QPlainTextEdit *text = new QPlainTextEdit(&dialog);
+    text->setReadOnly(true);
+    text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    text->setPlainText(QString::fromStdString(worker->stats().summary()));
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Save
+                                                         | QDialogButtonBox::Close,
+                                                     &dialog);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, [this, &dialog]() {
+        QString fileName = QFileDialog::getSaveFileName(&dialog,
+                                                        "Сохранить метрики",
+                                                        "metrics.prom",
+                                                        "Prometheus (*.prom);;JSON (*.json)");
+        if (fileName.isEmpty())
+            return;
+        std::string error;
+        if (!worker->stats().save(fileName.toStdString(), error))
+            QMessageBox::warning(&dialog, "Статистика", QString::fromStdString(error));
+    });
+
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(text);
+    layout->addWidget(buttons);
+    dialog.exec();
+}
 
 void MainWindow::openFile()
 {
@@ -78,492 +171,59 @@ void MainWindow::openFile()
         QFileInfo fileInfo(fileName);
         if (fileInfo.suffix().toLower() == "txt") {
             QString binFileName = fileInfo.path() + "/" + fileInfo.baseName() + ".bin";
-            appendToOutput("Выбран текстовый файл: " + fileName, "blue");
-            appendToOutput("Попытка конвертации в бинарный файл: " + binFileName, "blue");
-            if (convertToBinaryAndSave(fileName, binFileName)) {
-                currentFile = binFileName; // Если конвертация успешна, используем бинарный файл
-                appendToOutput("Для обработки будет использоваться бинарный файл: " + currentFile, "green");
-            } else {
-                currentFile = ""; // Если конвертация не удалась, сбрасываем файл
-                appendToOutput("Не удалось преобразовать текстовый файл в бинарный. Выберите другой файл.", "red");
-            }
+            appendToOutput(MessageKind::Note, "Выбран текстовый файл: " + fileName);
+            appendToOutput(MessageKind::Note, "Попытка конвертации в бинарный файл: " + binFileName);
+            currentFile = "";
+            setBusy(true);
+            emit convertRequested(fileName, binFileName);
         } else if (fileInfo.suffix().toLower() == "bin") {
             currentFile = fileName;
-            appendToOutput("Выбран бинарный файл: " + fileName, "blue");
+            appendToOutput(MessageKind::Note, "Выбран бинарный файл: " + fileName);
         } else {
-            appendToOutput("ERROR: Выбран файл с неподдерживаемым расширением. Выберите .txt или .bin файл.", "red");
+            appendToOutput(MessageKind::Error, "ERROR: Выбран файл с неподдерживаемым расширением. Выберите .txt или .bin файл.");
             currentFile = "";
         }
     }
 }
 
-bool MainWindow::convertToBinaryAndSave(const QString& txtFileName, const QString& binFileName)
+void MainWindow::fileConverted(bool ok, const QString &binFileName)
 {
-    std::ifstream inFile(txtFileName.toStdString(), std::ios::in);
-    if (!inFile.is_open()) {
-        appendToOutput("ERROR: Не удалось открыть текстовый файл для конвертации: " + txtFileName, "red");
-        return false;
-    }
-
-    std::ofstream outFile(binFileName.toStdString(), std::ios::out | std::ios::binary);
-    if (!outFile.is_open()) {
-        appendToOutput("ERROR: Не удалось создать бинарный файл: " + binFileName, "red");
-        inFile.close();
-        return false;
-    }
-
-    std::string line;
-    while (std::getline(inFile, line)) {
-        // Удаляем символы возврата каретки для совместимости с Windows
-        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
-        outFile.write(line.c_str(), line.length());
-        outFile.put('\n'); // Добавляем символ новой строки в бинарный файл
+    setBusy(false);
+    if (ok) {
+        currentFile = binFileName; // Если конвертация успешна, используем бинарный файл
+        appendToOutput(MessageKind::Success, "Для обработки будет использоваться бинарный файл: " + currentFile);
+    } else {
+        currentFile = ""; // Если конвертация не удалась, сбрасываем файл
+        appendToOutput(MessageKind::Error, "Не удалось преобразовать текстовый файл в бинарный. Выберите другой файл.");
     }
-
-    inFile.close();
-    outFile.close();
-    appendToOutput("Файл успешно преобразован в бинарный: " + binFileName, "green");
-    return true;
 }
 
 void MainWindow::clearOutput()
 {
-    textEdit->clear();
+    logModel->clear();
 }
 
 void MainWindow::runProgram()
 {
     if (currentFile.isEmpty()) {
-        appendToOutput("ERROR: Файл не выбран. Нажмите 'Open File'", "red");
+        appendToOutput(MessageKind::Error, "ERROR: Файл не выбран. Нажмите 'Open File'");
         return;
     }
 
-    textEdit->clear();
-    appendToOutput("Обработка файла: " + currentFile, "white");
+    logModel->clear();
+    appendToOutput(MessageKind::Text, "Обработка файла: " + currentFile);
 
-    std::queue<char> expression;
-    if (!readExpression(expression)) {
-        appendToOutput("Обработка файла остановлена из-за ошибок", "red");
-        return;
-    }
-
-    std::string RPN;
-    if (!convertToRPN(expression, RPN)) {
-        appendToOutput("Обработка файла остановлена из-за ошибок", "red");
-        return;
-    }
-
-    appendToOutput("Выражение конвентировано в ОПЗ:", "green");
-    appendToOutput(QString::fromStdString(RPN), "white");
-
-    std::map<std::string, double> operands;
-    if (!calculateRPN(RPN, operands)) {
-        appendToOutput("Обработка файла остановлена из-за ошибок", "red");
-    }
+    setBusy(true);
+    emit processRequested(currentFile, stepsBox->isChecked());
 }
 
-bool MainWindow::readExpression(std::queue<char> &expression)
+void MainWindow::cancelProgram()
 {
-    appendToOutput("\nЧтение выражения из файла...", "cyan");
-
-    std::ifstream in(currentFile.toStdString());
-    if (!in.is_open()) {
-        appendToOutput("ERROR: Файл не открыт", "red");
-        return false;
-    }
-
-    std::string line;
-    if (!std::getline(in, line)) {
-        appendToOutput("ERROR: Файл пуст", "red");
-        return false;
-    }
-
-    // Remove carriage returns for Windows compatibility
-    line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
-
-    for (char c : line) {
-        expression.push(c);
-    }
-
-    appendToOutput("Выражение успешно прочитано:", "cyan");
-    appendToOutput(QString::fromStdString(line), "white");
-    return true;
-}
-
-bool MainWindow::convertToRPN(std::queue<char> &expression, std::string &B)
-{
-    appendToOutput("\nПреобразование в ОПЗ и проверка на ошибки...", "cyan");
-
-    char a;
-    std::stack<char> stack1;
-    bool indicator = true;
-    char pred = 0;
-    QString errorMessage;
-    QString expressionOutput;
-
-    while (!expression.empty() && indicator) {
-        a = expression.front();
-        expression.pop();
-        expressionOutput += a;
-
-        if (a == '(' || a == '[' || a == '{') {
-            if (pred != '+' && pred != '-' && pred != '*' && pred != '/' && pred != '('
-                && pred != '[' && pred != '{' && pred != 0) {
-                errorMessage = QString("ОШИБКА: Отсутствует оператор перед '%1'").arg(a);
-                indicator = false;
-            } else {
-                stack1.push(a);
-            }
-        } else if ((a == '+' || a == '-' || a == '*' || a == '/') && expression.empty()) {
-            errorMessage = QString("ОШИБКА: Отсутствует правый операнд после '%1'").arg(a);
-            indicator = false;
-        } else if (a == ')') {
-            if (pred == '(') {
-                errorMessage = "ОШИБКА: Пустые скобки ()";
-                indicator = false;
-            } else {
-                if (stack1.empty()) {
-                    errorMessage = "ОШИБКА: Несоответствие скобок - нет открывающей скобки для )";
-                    indicator = false;
-                } else {
-                    while (stack1.top() != '(' && indicator) {
-                        if (stack1.empty()) {
-                            errorMessage
-                                = "ОШИБКА: Несоответствие скобок - нет открывающей скобки для )";
-                            indicator = false;
-                        } else if (pred == '-' || pred == '+' || pred == '*' || pred == '/') {
-                            errorMessage = "ОШИБКА: Отсутствует правый операнд";
-                            indicator = false;
-                        } else if (stack1.top() == '[') {
-                            errorMessage = "ОШИБКА: Незакрытая квадратная скобка [";
-                            indicator = false;
-                        } else if (stack1.top() == '{') {
-                            errorMessage = "ОШИБКА: Незакрытая фигурная скобка {";
-                            indicator = false;
-                        } else {
-                            B.push_back(stack1.top());
-                            B.push_back(' ');
-                            stack1.pop();
-                        }
-                    }
-                    if (indicator)
-                        stack1.pop();
-                }
-            }
-        } else if (a == ']') {
-            if (pred == '[') {
-                errorMessage = "ОШИБКА: Пустые скобки []";
-                indicator = false;
-            } else {
-                if (stack1.empty()) {
-                    errorMessage = "ОШИБКА: Несоответствие скобок - нет открывающей скобки для ]";
-                    indicator = false;
-                } else {
-                    while (stack1.top() != '[' && indicator) {
-                        if (stack1.empty()) {
-                            errorMessage
-                                = "ОШИБКА: Несоответствие скобок - нет открывающей скобки для ]";
-                            indicator = false;
-                        } else if (pred == '-' || pred == '+' || pred == '*' || pred == '/') {
-                            errorMessage = "ОШИБКА: Отсутствует правый операнд";
-                            indicator = false;
-                        } else if (stack1.top() == '(') {
-                            errorMessage = "ОШИБКА: Незакрытая круглая скобка (";
-                            indicator = false;
-                        } else if (stack1.top() == '{') {
-                            errorMessage = "ОШИБКА: Незакрытая фигурная скобка {";
-                            indicator = false;
-                        } else {
-                            B.push_back(stack1.top());
-                            B.push_back(' ');
-                            stack1.pop();
-                        }
-                    }
-                    if (indicator)
-                        stack1.pop();
-                }
-            }
-        } else if (a == '}') {
-            if (pred == '{') {
-                errorMessage = "ОШИБКА: Пустые скобки {}";
-                indicator = false;
-            } else {
-                if (stack1.empty()) {
-                    errorMessage = "ОШИБКА: Несоответствие скобок - нет открывающей скобки для }";
-                    indicator = false;
-                } else {
-                    while (stack1.top() != '{' && indicator) {
-                        if (stack1.empty()) {
-                            errorMessage
-                                = "ОШИБКА: Несоответствие скобок - нет открывающей скобки для }";
-                            indicator = false;
-                        } else if (pred == '-' || pred == '+' || pred == '*' || pred == '/') {
-                            errorMessage = "ОШИБКА: Отсутствует правый операнд";
-                            indicator = false;
-                        } else if (stack1.top() == '[') {
-                            errorMessage = "ОШИБКА: Незакрытая квадратная скобка [";
-                            indicator = false;
-                        } else if (stack1.top() == '(') {
-                            errorMessage = "ОШИБКА: Незакрытая круглая скобка (";
-                            indicator = false;
-                        } else {
-                            B.push_back(stack1.top());
-                            B.push_back(' ');
-                            stack1.pop();
-                        }
-                    }
-                    if (indicator)
-                        stack1.pop();
-                }
-            }
-        } else if ((a == '+' || a == '-' || a == '*' || a == '/') && stack1.empty() && pred != 0) {
-            stack1.push(a);
-        } else if ((a == '+' || a == '-')) {
-            if (pred == 0 || pred == '(' || pred == '[' || pred == '{') {
-                stack1.push(a);
-                B.push_back('0');
-                B.push_back(' ');
-                expressionOutput += "0";
-            } else if (pred == '*' || pred == '/' || pred == '+' || pred == '-') {
-                errorMessage = QString("ОШИБКА: Два оператора подряд: '%1%2'").arg(pred).arg(a);
-                indicator = false;
-            } else {
-                while (!stack1.empty() && stack1.top() != '(' && stack1.top() != '['
-                       && stack1.top() != '{') {
-                    B.push_back(stack1.top());
-                    B.push_back(' ');
-                    stack1.pop();
-                }
-                stack1.push(a);
-            }
-        } else if ((a == '*' || a == '/')) {
-            if (pred == 0 || pred == '(' || pred == '[' || pred == '{') {
-                errorMessage = QString("ОШИБКА: Отсутствует левый операнд для '%1'").arg(a);
-                indicator = false;
-            } else if (pred == '*' || pred == '/' || pred == '+' || pred == '-') {
-                errorMessage = QString("ОШИБКА: Два оператора подряд: '%1%2'").arg(pred).arg(a);
-                indicator = false;
-            } else {
-                while (!stack1.empty() && stack1.top() != '(' && stack1.top() != '['
-                       && stack1.top() != '{' && stack1.top() != '+' && stack1.top() != '-') {
-                    B.push_back(stack1.top());
-                    B.push_back(' ');
-                    stack1.pop();
-                }
-                stack1.push(a);
-            }
-        } else {
-            if (pred == ')' || pred == ']' || pred == '}') {
-                errorMessage
-                    = QString("ОШИБКА: Отсутствует оператор после '%1' перед '%2'").arg(pred).arg(a);
-                indicator = false;
-            } else if (pred != 0 && pred != '(' && pred != ')' && pred != '[' && pred != ']'
-                       && pred != '{' && pred != '}' && pred != '+' && pred != '-' && pred != '*'
-                       && pred != '/') {
-                // Для многосимвольных операндов удаляем пробел между символами
-                if (!B.empty())
-                    B.pop_back();
-            }
-            B.push_back(a);
-            B.push_back(' ');
-        }
-        pred = a;
-    }
-
-    while (!stack1.empty() && indicator) {
-        if (stack1.top() == '(') {
-            errorMessage = "ОШИБКА: Незакрытая круглая скобка (";
-            indicator = false;
-        } else if (stack1.top() == '[') {
-            errorMessage = "ОШИБКА: Незакрытая квадратная скобка [";
-            indicator = false;
-        } else if (stack1.top() == '{') {
-            errorMessage = "ОШИБКА: Незакрытая фигурная скобка {";
-            indicator = false;
-        } else {
-            B.push_back(stack1.top());
-            B.push_back(' ');
-            stack1.pop();
-        }
-    }
-
-    if (!indicator) {
-        appendToOutput("Выражение: " + expressionOutput, "blue");
-        appendToOutput(errorMessage, "red");
-        return false;
-    }
-
-    if (B.empty()) {
-        appendToOutput("ОШИБКА: Пустое выражение после преобразования", "red");
-        return false;
-    }
-
-    appendToOutput("Выражение успешно обработано", "green");
-    return true;
+    cancelButton->setEnabled(false);
+    worker->cancel();
 }
 
-bool MainWindow::calculateRPN(std::string &B, std::map<std::string, double> &operands)
+void MainWindow::programFinished()
 {
-    std::ifstream in(currentFile.toStdString());
-    if (!in.is_open()) {
-        appendToOutput("ERROR: ошибка при повторном открытии файла", "red");
-        return false;
-    }
-
-    std::string line;
-    std::getline(in, line);
-
-    int lineNum = 2;
-    while (std::getline(in, line)) {
-        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
-
-        if (line.empty())
-            continue;
-
-        size_t pos = line.find('=');
-        if (pos == std::string::npos) {
-            appendToOutput(QString("ERROR: Строка %1 - пропуск '='").arg(lineNum), "red");
-            return false;
-        }
-
-        std::string name = line.substr(0, pos);
-        size_t start = name.find_first_not_of(" \t");
-        size_t end = name.find_last_not_of(" \t");
-        if (start == std::string::npos) {
-            appendToOutput(QString("ERROR: Строка %1 - отсутствует имя операнда").arg(lineNum),
-                           "red");
-            return false;
-        }
-        name = name.substr(start, end - start + 1);
-
-        if (std::all_of(name.begin(), name.end(), [](char c) { return std::isdigit(c); })) {
-            appendToOutput(QString("ERROR: Строка %1 - имя операнда не может быть числом: '%2'")
-                               .arg(lineNum)
-                               .arg(QString::fromStdString(name)),
-                           "red");
-            return false;
-        }
-
-        std::string valueStr = line.substr(pos + 1);
-        start = valueStr.find_first_not_of(" \t");
-        if (start == std::string::npos) {
-            appendToOutput(QString("ERROR: Строка %1 - пропущено значение операнда").arg(lineNum),
-                           "red");
-            return false;
-        }
-        valueStr = valueStr.substr(start);
-
-        std::replace(valueStr.begin(), valueStr.end(), ',', '.');
-
-        try {
-            double value = std::stod(valueStr);
-            operands[name] = value;
-            appendToOutput(QString("Операнд: %1 = %2").arg(QString::fromStdString(name)).arg(value),
-                           "blue");
-        } catch (const std::exception &) {
-            appendToOutput(QString("ERROR: Строка %1 - некорректное значение: '%2'")
-                               .arg(lineNum)
-                               .arg(QString::fromStdString(valueStr)),
-                           "red");
-            return false;
-        }
-
-        lineNum++;
-    }
-
-    B += ' ';
-    std::stack<double> stack2;
-    std::string token;
-    size_t pos = 0;
-    bool indicator = true;
-    QString calculationLog = "Шаги расчета:\n";
-
-    while ((pos = B.find(' ')) != std::string::npos && indicator) {
-        token = B.substr(0, pos);
-        B.erase(0, pos + 1);
-
-        if (token.empty())
-            continue;
-
-        if (token == "+" || token == "-" || token == "*" || token == "/") {
-            if (stack2.size() < 2) {
-                appendToOutput("ERROR: Недостаточно операндов для оператора: "
-                                   + QString::fromStdString(token),
-                               "red");
-                return false;
-            }
-
-            double b = stack2.top();
-            stack2.pop();
-            double a = stack2.top();
-            stack2.pop();
-            double result = 0;
-
-            if (token == "+")
-                result = a + b;
-            else if (token == "-")
-                result = a - b;
-            else if (token == "*")
-                result = a * b;
-            else if (token == "/") {
-                if (b == 0) {
-                    appendToOutput("ERROR: деление на ноль", "red");
-                    return false;
-                }
-                result = a / b;
-            }
-
-            calculationLog += QString("\n  %1 %2 %3 = %4")
-                                  .arg(a)
-                                  .arg(QString::fromStdString(token))
-                                  .arg(b)
-                                  .arg(result);
-            stack2.push(result);
-        } else if (std::all_of(token.begin(), token.end(), [](char c) {
-                       return std::isdigit(c) || c == '.' || c == ',';
-                   })) {
-            std::replace(token.begin(), token.end(), ',', '.');
-            try {
-                stack2.push(std::stod(token));
-                calculationLog += QString("\n  Поместили операнд: %1")
-                                      .arg(QString::fromStdString(token));
-            } catch (const std::exception &) {
-                appendToOutput("ERROR: Некорректный числовой формат: "
-                                   + QString::fromStdString(token),
-                               "red");
-                return false;
-            }
-        } else {
-            if (operands.find(token) == operands.end()) {
-                appendToOutput("ERROR: Неопределённый операнд: " + QString::fromStdString(token),
-                               "red");
-                return false;
-            }
-            double value = operands[token];
-            stack2.push(value);
-            calculationLog += QString("\n  Поместили операнд %1 = %2")
-                                  .arg(QString::fromStdString(token))
-                                  .arg(value);
-        }
-    }
-
-    if (stack2.size() != 1) {
-        appendToOutput("ERROR: Неверно сформированное RPN выражение", "red");
-        return false;
-    }
-    QString resultStr = formatDouble(stack2.top());
-
-    appendToOutput(calculationLog, "green");
-    appendToOutput("\nРезультат: " + resultStr, "white");
-    return true;
-}
-QString MainWindow::formatDouble(double value)
-{
-    QString result = QString::number(value, 'g', 10);
-    result.replace('.', ',');
-
-    if (result.contains(',') && result.split(',')[1].toDouble() == 0) {
-        result = result.split(',')[0];
-    }
-    return result;
+    setBusy(false);
 }
@@ -1,14 +1,15 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QCheckBox>
 #include <QFile>
+#include <QListView>
 #include <QMainWindow>
+#include <QProgressBar>
 #include <QPushButton>
-#include <QTextEdit>
-#include <map>
-#include <queue>
-#include <stack>
-#include <string>
+#include <QThread>
+#include "evalworker.h"
+#include "logmodel.h"
 
 class MainWindow : public QMainWindow
 {
@@ -16,27 +17,41 @@ class MainWindow : public QMainWindow
 
 public:
     explicit MainWindow(QWidget *parent = nullptr);
+    ~MainWindow() override;
+
+signals:
+    void processRequested(const QString &fileName, bool steps);
+    void convertRequested(const QString &txtFileName, const QString &binFileName);
 
 private slots:
     void runProgram();
+    void cancelProgram();
     void showAbout();
+    void showStats();
     void openFile();
     void clearOutput();
+    void appendMessages(const QVector<EvalMessage> &batch);
+    void programFinished();
+    void fileConverted(bool ok, const QString &binFileName);
 
 private:
-    bool readExpression(std::queue<char> &expression);
-    bool convertToRPN(std::queue<char> &expression, std::string &B);
-    bool calculateRPN(std::string &B, std::map<std::string, double> &operands);
-    void appendToOutput(const QString &text, const QString &color = "black");
-    QString formatDouble(double value);
-    bool convertToBinaryAndSave(const QString& txtFileName, const QString& binFileName);
-
-    QTextEdit *textEdit;
+    void appendToOutput(MessageKind kind, const QString &text);
+    void setBusy(bool busy);
+
+    QListView *logView;
+    LogModel *logModel;
+    QCheckBox *stepsBox;
     QPushButton *runButton;
     QPushButton *aboutButton;
+    QPushButton *statsButton;
     QPushButton *openButton;
     QPushButton *clearButton;
+    QPushButton *cancelButton;
+    QProgressBar *progressBar;
     QString currentFile;
+    // Файлы обрабатываются в workerThread, окно остаётся отзывчивым
+    QThread workerThread;
+    EvalWorker *worker;
 };
 
 #endif // MAINWINDOW_H
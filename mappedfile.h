@@ -0,0 +1,41 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Файл, отображённый в память только для чтения: разбор идёт прямо по байтам
+// отображения, без копирования в строки и повторного открытия
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &fileName);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+    std::string_view view() const { return std::string_view(bytes, length); }
+
+private:
+    const char *bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
+
+// Делит текст на строки: line - очередная строка без '\n' и завершающего '\r',
+// text - остаток после неё. Возвращает false, когда строки закончились
+bool nextLine(std::string_view &text, std::string_view &line);
+
+#endif // MAPPEDFILE_H
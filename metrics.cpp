@@ -0,0 +1,255 @@
+#include "metrics.h"
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+constexpr std::memory_order Relaxed = std::memory_order_relaxed;
+
+size_t bucketIndex(std::uint64_t nanoseconds)
+{
+    size_t index = 0;
+    while (index + 1 < Metrics::BucketCount
+           && nanoseconds > (std::uint64_t(1) << (Metrics::FirstBucket + index)))
+        ++index;
+    return index;
+}
+
+// Верхняя граница корзины в секундах, как принято в Prometheus
+std::string bucketBound(size_t index)
+{
+    if (index + 1 == Metrics::BucketCount)
+        return "+Inf";
+    char buffer[32];
+    std::snprintf(buffer,
+                  sizeof(buffer),
+                  "%.9g",
+                  static_cast<double>(std::uint64_t(1) << (Metrics::FirstBucket + index)) * 1e-9);
+    return buffer;
+}
+
+std::string number(std::uint64_t value)
+{
+    return std::to_string(value);
+}
+
+} // namespace
+
+void Metrics::record(Stage stage, std::uint64_t nanoseconds)
+{
+    Histogram &histogram = stages[static_cast<size_t>(stage)];
+    histogram.count.fetch_add(1, Relaxed);
+    histogram.sum.fetch_add(nanoseconds, Relaxed);
+    histogram.buckets[bucketIndex(nanoseconds)].fetch_add(1, Relaxed);
+}
+
+void Metrics::countError(ErrorCategory category)
+{
+    errors[static_cast<size_t>(category)].fetch_add(1, Relaxed);
+}
+
+void Metrics::countFile(bool ok)
+{
+    files.fetch_add(1, Relaxed);
+    if (!ok)
+        failedFiles.fetch_add(1, Relaxed);
+}
+
+void Metrics::countTokens(size_t count)
+{
+    tokens.fetch_add(count, Relaxed);
+}
+
+void Metrics::countOperands(size_t count)
+{
+    operands.fetch_add(count, Relaxed);
+}
+
+void Metrics::reset()
+{
+    for (Histogram &histogram : stages) {
+        histogram.count.store(0, Relaxed);
+        histogram.sum.store(0, Relaxed);
+        for (auto &bucket : histogram.buckets)
+            bucket.store(0, Relaxed);
+    }
+    for (auto &error : errors)
+        error.store(0, Relaxed);
+    files.store(0, Relaxed);
+    failedFiles.store(0, Relaxed);
+    tokens.store(0, Relaxed);
+    operands.store(0, Relaxed);
+}
+
+const char *Metrics::stageName(Stage stage)
+{
+    static const char *const Names[StageCount]
+        = {"open", "read", "convert", "operands", "evaluate", "file"};
+    return Names[static_cast<size_t>(stage)];
+}
+
+const char *Metrics::errorName(ErrorCategory category)
+{
+    static const char *const Names[ErrorCount] = {"file",
+                                                  "syntax",
+                                                  "brackets",
+                                                  "operand_line",
+                                                  "bad_number",
+                                                  "undefined_operand",
+                                                  "division_by_zero",
+                                                  "malformed",
+                                                  "cancelled"};
+    return Names[static_cast<size_t>(category)];
+}
+
+std::string Metrics::json() const
+{
+    std::string text = "{\"files\":" + number(files.load(Relaxed))
+                       + ",\"failed_files\":" + number(failedFiles.load(Relaxed))
+                       + ",\"tokens\":" + number(tokens.load(Relaxed))
+                       + ",\"operands\":" + number(operands.load(Relaxed)) + ",\"errors\":{";
+    for (size_t i = 0; i < ErrorCount; ++i) {
+        text += i ? ",\"" : "\"";
+        text += errorName(static_cast<ErrorCategory>(i));
+        text += "\":" + number(errors[i].load(Relaxed));
+    }
+    text += "},\"stages\":{";
+    for (size_t i = 0; i < StageCount; ++i) {
+        const Histogram &histogram = stages[i];
+        text += i ? ",\"" : "\"";
+        text += stageName(static_cast<Stage>(i));
+        text += "\":{\"count\":" + number(histogram.count.load(Relaxed))
+                + ",\"sum_ns\":" + number(histogram.sum.load(Relaxed)) + ",\"buckets\":[";
+        for (size_t k = 0; k < BucketCount; ++k) {
+            if (k)
+                text += ',';
+            text += number(histogram.buckets[k].load(Relaxed));
+        }
+        text += "]}";
+    }
+    text += "},\"bucket_bounds_ns\":[";
+    for (size_t k = 0; k + 1 < BucketCount; ++k) {
+        if (k)
+            text += ',';
+        text += number(std::uint64_t(1) << (FirstBucket + k));
+    }
+    text += "]}\n";
+    return text;
+}
+
+std::string Metrics::prometheus() const
+{
+    std::string text;
+    auto counter = [&text](const char *name, const char *help, std::uint64_t value) {
+        text += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name + " counter\n"
+                + name + " " + number(value) + "\n";
+    };
+    counter("nature_files_total", "Обработано файлов.", files.load(Relaxed));
+    counter("nature_failed_files_total",
+            "Файлов, обработка которых остановлена ошибкой.",
+            failedFiles.load(Relaxed));
+    counter("nature_tokens_total", "Лексем ОПЗ в преобразованных выражениях.", tokens.load(Relaxed));
+    counter("nature_operands_total", "Прочитано строк операндов.", operands.load(Relaxed));
+
+    text += "# HELP nature_errors_total Ошибки по причинам.\n"
+            "# TYPE nature_errors_total counter\n";
+    for (size_t i = 0; i < ErrorCount; ++i) {
+        text += std::string("nature_errors_total{category=\"")
+                + errorName(static_cast<ErrorCategory>(i))
+                + "\"} " + number(errors[i].load(Relaxed)) + "\n";
+    }
+
+    text += "# HELP nature_stage_seconds Задержки этапов конвейера.\n"
+            "# TYPE nature_stage_seconds histogram\n";
+    for (size_t i = 0; i < StageCount; ++i) {
+        const Histogram &histogram = stages[i];
+        const std::string label = std::string("stage=\"") + stageName(static_cast<Stage>(i))
+                                  + "\"";
+        std::uint64_t cumulative = 0;
+        for (size_t k = 0; k < BucketCount; ++k) {
+            cumulative += histogram.buckets[k].load(Relaxed);
+            text += "nature_stage_seconds_bucket{" + label + ",le=\"" + bucketBound(k) + "\"} "
+                    + number(cumulative) + "\n";
+        }
+        char sum[32];
+        std::snprintf(sum, sizeof(sum), "%.9g", histogram.sum.load(Relaxed) * 1e-9);
+        text += "nature_stage_seconds_sum{" + label + "} " + sum + "\n";
+        text += "nature_stage_seconds_count{" + label + "} " + number(cumulative) + "\n";
+    }
+    return text;
+}
+
+std::string Metrics::summary() const
+{
+    char line[160];
+    std::snprintf(line,
+                  sizeof(line),
+                  "Файлов: %llu, с ошибками: %llu; лексем ОПЗ: %llu; строк операндов: %llu\n\n",
+                  static_cast<unsigned long long>(files.load(Relaxed)),
+                  static_cast<unsigned long long>(failedFiles.load(Relaxed)),
+                  static_cast<unsigned long long>(tokens.load(Relaxed)),
+                  static_cast<unsigned long long>(operands.load(Relaxed)));
+    std::string text = line;
+
+    // p99 - верхняя граница корзины, в которую попадает 99% замеров
+    text += "Этап       замеров     среднее, мкс    p99 до, мкс\n";
+    for (size_t i = 0; i < StageCount; ++i) {
+        const Histogram &histogram = stages[i];
+        const std::uint64_t count = histogram.count.load(Relaxed);
+        double mean = count ? histogram.sum.load(Relaxed) * 1e-3 / count : 0;
+        std::uint64_t seen = 0;
+        size_t p99 = 0;
+        while (p99 + 1 < BucketCount
+               && (seen += histogram.buckets[p99].load(Relaxed)) * 100 < count * 99)
+            ++p99;
+        char bound[32] = "-";
+        if (count && p99 + 1 < BucketCount)
+            std::snprintf(bound,
+                          sizeof(bound),
+                          "%.3f",
+                          (std::uint64_t(1) << (FirstBucket + p99)) * 1e-3);
+        std::snprintf(line,
+                      sizeof(line),
+                      "%-10s %7llu %16.3f %14s\n",
+                      stageName(static_cast<Stage>(i)),
+                      static_cast<unsigned long long>(count),
+                      mean,
+                      bound);
+        text += line;
+    }
+
+    text += "\nОшибки:\n";
+    for (size_t i = 0; i < ErrorCount; ++i) {
+        std::snprintf(line,
+                      sizeof(line),
+                      "  %-18s %llu\n",
+                      errorName(static_cast<ErrorCategory>(i)),
+                      static_cast<unsigned long long>(errors[i].load(Relaxed)));
+        text += line;
+    }
+    return text;
+}
+
+bool Metrics::save(const std::string &fileName, std::string &error) const
+{
+    const bool asJson = fileName.size() >= 5
+                        && fileName.compare(fileName.size() - 5, 5, ".json") == 0;
+    const std::string text = asJson ? json() : prometheus();
+
+    // Запись во временный файл и переименование: сборщик не прочитает половину снимка
+    const std::string partial = fileName + ".tmp";
+    {
+        std::ofstream out(partial, std::ios::binary);
+        out << text;
+        if (!out) {
+            error = "ERROR: Не удалось записать метрики: " + fileName;
+            return false;
+        }
+    }
+    if (std::rename(partial.c_str(), fileName.c_str()) != 0) {
+        std::remove(partial.c_str());
+        error = "ERROR: Не удалось записать метрики: " + fileName;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,107 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Этапы обработки файла; File - весь файл целиком
+enum class Stage { Open, Read, Convert, Operands, Evaluate, File };
+
+// Причины ошибок обработки
+enum class ErrorCategory {
+    File,             // файл не открыт или повреждён
+    Syntax,           // пустой файл, операторы и операнды выражения
+    Brackets,         // несоответствие и незакрытые скобки
+    OperandLine,      // строка операнда без '=', имени или значения
+    BadNumber,        // некорректный числовой формат
+    UndefinedOperand, // операнд выражения не задан
+    DivisionByZero,
+    Malformed, // неверно сформированная ОПЗ
+    Cancelled
+};
+
+// Счётчики и гистограммы задержек конвейера, общие для нескольких Engine (и потоков).
+// Обновление - относительные атомарные операции без блокировок; снимок читается
+// в любой момент. Гистограмма - корзины по степеням двойки наносекунд.
+// Сборка с NATURE_NO_METRICS убирает замеры из Engine полностью
+class Metrics
+{
+public:
+    static constexpr size_t StageCount = 6;
+    static constexpr size_t ErrorCount = 9;
+    // Корзины до 2^(FirstBucket + i) нс: от 256 нс до ~69 с, последняя - остальное
+    static constexpr size_t FirstBucket = 8;
+    static constexpr size_t BucketCount = 29;
+
+    void record(Stage stage, std::uint64_t nanoseconds);
+    void countError(ErrorCategory category);
+    void countFile(bool ok);
+    void countTokens(size_t count);
+    void countOperands(size_t count);
+    void reset();
+
+    std::string json() const;
+    // Текстовый формат Prometheus (exposition format 0.0.4)
+    std::string prometheus() const;
+    // Сводка для людей: задержки этапов (среднее и p99) и ошибки по причинам
+    std::string summary() const;
+    // Снимок в файл: *.json - JSON, иначе текст Prometheus
+    bool save(const std::string &fileName, std::string &error) const;
+
+    static const char *stageName(Stage stage);
+    static const char *errorName(ErrorCategory category);
+
+private:
+    struct Histogram
+    {
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> sum{0}; // нс
+        std::array<std::atomic<std::uint64_t>, BucketCount> buckets{};
+    };
+
+    std::array<Histogram, StageCount> stages;
+    std::array<std::atomic<std::uint64_t>, ErrorCount> errors{};
+    std::atomic<std::uint64_t> files{0};
+    std::atomic<std::uint64_t> failedFiles{0};
+    std::atomic<std::uint64_t> tokens{0};
+    std::atomic<std::uint64_t> operands{0};
+};
+
+// Замер этапа от создания до разрушения; metrics == nullptr - без замера
+class StageTimer
+{
+public:
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+#ifdef NATURE_NO_METRICS
+    StageTimer(Metrics *, Stage) {}
+#else
+    StageTimer(Metrics *metrics, Stage stage)
+        : metrics(metrics)
+        , stage(stage)
+    {
+        if (metrics)
+            started = std::chrono::steady_clock::now();
+    }
+
+    ~StageTimer()
+    {
+        if (metrics) {
+            auto elapsed = std::chrono::steady_clock::now() - started;
+            metrics->record(stage,
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+private:
+    Metrics *metrics;
+    Stage stage;
+    std::chrono::steady_clock::time_point started;
+#endif
+};
+
+#endif // METRICS_H
@@ -0,0 +1,384 @@
+#include "native.h"
+#include "operators.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Без -ffp-contract=off компилятор вправе слить a*b+c в FMA и изменить округление
+const char *const CompileFlags = "-std=c++17 -O2 -fPIC -shared -ffp-contract=off -fno-fast-math";
+
+std::string hex(std::uint64_t value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+std::uint64_t hashText(const std::string &text)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+#ifndef _WIN32
+// Библиотека из каталога подгружается в процесс, поэтому и каталог, и файл должны
+// принадлежать текущему пользователю и быть недоступны другим для записи
+bool isPrivate(const fs::path &path, bool directory)
+{
+    struct stat info;
+    if (lstat(path.c_str(), &info) != 0 || info.st_uid != geteuid()
+        || (info.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+        return false;
+    return directory ? S_ISDIR(info.st_mode) : S_ISREG(info.st_mode);
+}
+
+// Кэш библиотек: $XDG_CACHE_HOME/nature_native, иначе nature_native-<uid>
+// во временном каталоге; создаётся с правами 0700
+bool cacheDirectory(fs::path &directory, std::string &error)
+{
+    std::error_code code;
+    const char *xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg == '/') {
+        fs::create_directories(xdg, code);
+        directory = fs::path(xdg) / "nature_native";
+    } else {
+        directory = fs::temp_directory_path(code)
+                    / ("nature_native-" + std::to_string(geteuid()));
+    }
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        error = "ERROR: Не удалось создать каталог машинного кода: " + directory.string();
+        return false;
+    }
+    if (!isPrivate(directory, true)) {
+        error = "ERROR: Каталог машинного кода доступен другим пользователям: "
+                + directory.string();
+        return false;
+    }
+    return true;
+}
+
+// Слова команды через пробел: NATURE_CXX может быть, например, "ccache g++"
+void splitWords(const char *text, std::vector<std::string> &words)
+{
+    std::string word;
+    for (const char *c = text;; ++c) {
+        if (*c == ' ' || *c == '\0') {
+            if (!word.empty())
+                words.push_back(word);
+            word.clear();
+            if (*c == '\0')
+                return;
+        } else {
+            word += *c;
+        }
+    }
+}
+
+// Компилятор запускается без оболочки: пути передаются отдельными аргументами,
+// вывод ошибок - в log. Результат - код завершения, -1 - запуск не удался
+int runCompiler(const char *compiler,
+                const fs::path &output,
+                const fs::path &source,
+                const fs::path &log)
+{
+    std::vector<std::string> words;
+    splitWords(compiler, words);
+    splitWords(CompileFlags, words);
+    words.push_back("-o");
+    words.push_back(output.string());
+    words.push_back(source.string());
+    std::vector<char *> argv;
+    for (std::string &word : words)
+        argv.push_back(&word[0]);
+    argv.push_back(nullptr);
+
+    const pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        const int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0)
+            dup2(fd, 2);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+#endif
+
+// Запись операции из таблицы operators.cpp с подставленными операндами
+std::string expand(const char *pattern, const std::string &a, const std::string &b)
+{
+    std::string text;
+    for (const char *c = pattern; *c; ++c) {
+        if (c[0] == '%' && (c[1] == 'a' || c[1] == 'b')) {
+            text += *++c == 'a' ? a : b;
+        } else {
+            text += *c;
+        }
+    }
+    return text;
+}
+
+// Тело вычисления: значение каждой команды - своя константа vN, как в SSA.
+// Store/Load не порождают кода: ячейка - просто имя уже вычисленного значения.
+// Деление на ноль не прерывает вычисление, а отмечается в fail - при ошибке
+// результат всё равно отбрасывается, а без ветвлений цикл по строкам векторизуется
+std::string emitBody(const Program &program, bool rows, const char *indent, std::string &top)
+{
+    std::string body;
+    std::vector<std::string> stack;
+    std::vector<std::string> temps(program.tempCount());
+    size_t next = 0;
+    for (const Instruction &ins : program.code()) {
+        std::string name = "v" + std::to_string(next++);
+        std::string expression;
+        switch (ins.op) {
+        case OpCode::Constant:
+            expression = "k" + std::to_string(ins.arg);
+            break;
+        case OpCode::Variable: {
+            std::string slot = std::to_string(ins.arg);
+            expression = rows ? "c" + slot + " ? c" + slot + "[r] : s" + slot : "s[" + slot + "]";
+            break;
+        }
+        case OpCode::Store:
+            temps[ins.arg] = stack.back();
+            continue;
+        case OpCode::Load:
+            stack.push_back(temps[ins.arg]);
+            continue;
+        case OpCode::Negate:
+            expression = "0.0 - " + stack.back();
+            stack.pop_back();
+            break;
+        default: {
+            const Operator &entry = *operatorFor(ins.op);
+            std::string b;
+            if (entry.arity == 2) {
+                b = stack.back();
+                stack.pop_back();
+            }
+            std::string a = stack.back();
+            stack.pop_back();
+            if (ins.op == OpCode::Divide)
+                body += std::string(indent) + "fail |= " + b + " == 0;\n";
+            expression = expand(entry.cxx, a, b);
+            break;
+        }
+        }
+        body += std::string(indent) + "const double " + name + " = " + expression + ";\n";
+        stack.push_back(name);
+    }
+    top = stack.back();
+    return body;
+}
+
+} // namespace
+
+NativeProgram::~NativeProgram()
+{
+    unload();
+}
+
+bool NativeProgram::supported()
+{
+#ifdef _WIN32
+    return false;
+#else
+    return true;
+#endif
+}
+
+std::string NativeProgram::source(const Program &program)
+{
+    std::string text = "// Сгенерировано nature: машинный код выражения\n"
+                       "#include <cmath>\n"
+                       "#include <cstddef>\n"
+                       "#include <cstdint>\n"
+                       "#include <cstring>\n"
+                       "#include <limits>\n\n"
+                       "namespace {\n"
+                       "inline double bits(std::uint64_t value)\n"
+                       "{\n"
+                       "    double result;\n"
+                       "    std::memcpy(&result, &value, sizeof(result));\n"
+                       "    return result;\n"
+                       "}\n";
+    for (size_t i = 0; i < program.constantCount(); ++i) {
+        std::uint64_t value = 0;
+        double constant = program.constant(static_cast<std::uint32_t>(i));
+        std::memcpy(&value, &constant, sizeof(value));
+        text += "const double k" + std::to_string(i) + " = bits(0x" + hex(value) + "ull);\n";
+    }
+    text += "} // namespace\n\n";
+
+    std::string top;
+    text += "extern \"C\" int nature_native_evaluate(const double *s, double *result)\n"
+            "{\n"
+            "    int fail = 0;\n";
+    text += emitBody(program, false, "    ", top);
+    text += "    *result = " + top + ";\n"
+            "    return fail;\n"
+            "}\n\n";
+
+    text += "extern \"C\" std::size_t nature_native_rows(const double *const *sources,\n"
+            "                                          const double *scalars,\n"
+            "                                          std::size_t begin,\n"
+            "                                          std::size_t end,\n"
+            "                                          double *out,\n"
+            "                                          unsigned char *failed)\n"
+            "{\n";
+    for (size_t slot = 0; slot < program.variableCount(); ++slot) {
+        std::string n = std::to_string(slot);
+        text += "    const double *const c" + n + " = sources[" + n + "];\n";
+        text += "    const double s" + n + " = scalars[" + n + "];\n";
+    }
+    text += "    std::size_t failures = 0;\n"
+            "    for (std::size_t r = begin; r < end; ++r) {\n"
+            "        int fail = 0;\n";
+    text += emitBody(program, true, "        ", top);
+    text += "        out[r - begin] = fail ? std::numeric_limits<double>::quiet_NaN() : " + top
+            + ";\n"
+              "        failed[r - begin] = static_cast<unsigned char>(fail);\n"
+              "        failures += fail;\n"
+              "    }\n"
+              "    return failures;\n"
+              "}\n";
+    return text;
+}
+
+bool NativeProgram::build(const Program &program, std::string &error)
+{
+    unload();
+    if (!program.isWellFormed()) {
+        error = "ERROR: Машинный код строится только для корректного выражения";
+        return false;
+    }
+#ifdef _WIN32
+    error = "ERROR: Машинный код на этой платформе не поддерживается";
+    return false;
+#else
+    const char *compiler = std::getenv("NATURE_CXX");
+    if (!compiler || !*compiler)
+        compiler = "c++";
+    const std::string text = source(program);
+    const std::string name = "expr_" + hex(hashText(text + compiler + CompileFlags));
+
+    std::error_code code;
+    fs::path directory;
+    if (!cacheDirectory(directory, error))
+        return false;
+    fs::path library = directory / (name + ".so");
+
+    // Чужую или доступную для записи другим библиотеку не загружаем, а собираем заново
+    if (!isPrivate(library, false)) {
+        fs::remove(library, code);
+        // Сборка во временное имя и переименование: параллельные процессы
+        // не увидят недописанную библиотеку
+        std::string unique = hex(std::random_device()());
+        fs::path sourceFile = directory / (name + "." + unique + ".cpp");
+        fs::path partial = directory / (name + "." + unique + ".so");
+        fs::path log = directory / (name + "." + unique + ".log");
+        {
+            std::ofstream out(sourceFile, std::ios::binary);
+            out << text;
+            if (!out) {
+                error = "ERROR: Не удалось записать исходный текст: " + sourceFile.string();
+                return false;
+            }
+        }
+
+        int status = runCompiler(compiler, partial, sourceFile, log);
+        fs::remove(sourceFile, code);
+        if (status != 0) {
+            std::ifstream in(log);
+            std::string first;
+            std::getline(in, first);
+            error = "ERROR: Не удалось собрать машинный код (" + std::string(compiler) + ")";
+            if (!first.empty())
+                error += ": " + first;
+            fs::remove(log, code);
+            fs::remove(partial, code);
+            return false;
+        }
+        fs::remove(log, code);
+        fs::rename(partial, library, code);
+        if (code) {
+            error = "ERROR: Не удалось сохранить библиотеку: " + library.string();
+            fs::remove(partial, code);
+            return false;
+        }
+    }
+
+    handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        error = "ERROR: Не удалось загрузить машинный код: " + std::string(dlerror());
+        return false;
+    }
+    evaluateFn = reinterpret_cast<EvaluateFn>(dlsym(handle, "nature_native_evaluate"));
+    rowsFn = reinterpret_cast<RowsFn>(dlsym(handle, "nature_native_rows"));
+    if (!evaluateFn || !rowsFn) {
+        error = "ERROR: В библиотеке нет функций вычисления: " + library.string();
+        unload();
+        return false;
+    }
+    return true;
+#endif
+}
+
+EvalStatus NativeProgram::evaluate(const double *slots, double &result) const
+{
+    double value = 0;
+    if (evaluateFn(slots, &value) != 0)
+        return EvalStatus::DivisionByZero;
+    result = value;
+    return EvalStatus::Ok;
+}
+
+size_t NativeProgram::evaluateRows(const double *const *sources,
+                                   const double *scalars,
+                                   size_t begin,
+                                   size_t end,
+                                   double *out,
+                                   std::uint8_t *failed) const
+{
+    return rowsFn(sources, scalars, begin, end, out, failed);
+}
+
+void NativeProgram::unload()
+{
+    evaluateFn = nullptr;
+    rowsFn = nullptr;
+#ifndef _WIN32
+    if (handle)
+        dlclose(handle);
+#endif
+    handle = nullptr;
+}
@@ -0,0 +1,60 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include "program.h"
+#include <cstdint>
+#include <string>
+
+// Необязательный машинный код для горячих выражений: программа переводится
+// в исходный текст C++, собирается локальным компилятором (NATURE_CXX, иначе c++)
+// в разделяемую библиотеку и подгружается через dlopen. Библиотека кэшируется
+// по хэшу исходного текста в личном каталоге пользователя ($XDG_CACHE_HOME/nature_native,
+// иначе nature_native-<uid> во временном каталоге, права 0700); загружается только
+// файл этого пользователя, недоступный другим для записи.
+// Вычисление побитово совпадает с Program::evaluate: те же операции в том же
+// порядке, без сжатия в FMA, константы переносятся точным битовым образом.
+// Если сборка невозможна, build() возвращает false - вызывающий остаётся
+// на интерпретаторе
+class NativeProgram
+{
+public:
+    NativeProgram() = default;
+    ~NativeProgram();
+    NativeProgram(const NativeProgram &) = delete;
+    NativeProgram &operator=(const NativeProgram &) = delete;
+
+    // Поддерживает ли платформа загрузку собранного кода
+    static bool supported();
+    // Исходный текст для программы (isWellFormed)
+    static std::string source(const Program &program);
+
+    bool build(const Program &program, std::string &error);
+    bool ready() const { return evaluateFn != nullptr; }
+
+    EvalStatus evaluate(const double *slots, double &result) const;
+    // Строки [begin, end) как у ColumnEvaluator: sources[slot] - столбец или nullptr,
+    // тогда значение берётся из scalars[slot]. Возвращает число делений на ноль
+    size_t evaluateRows(const double *const *sources,
+                        const double *scalars,
+                        size_t begin,
+                        size_t end,
+                        double *out,
+                        std::uint8_t *failed) const;
+
+private:
+    using EvaluateFn = int (*)(const double *slots, double *result);
+    using RowsFn = size_t (*)(const double *const *sources,
+                              const double *scalars,
+                              size_t begin,
+                              size_t end,
+                              double *out,
+                              unsigned char *failed);
+
+    void unload();
+
+    void *handle = nullptr;
+    EvaluateFn evaluateFn = nullptr;
+    RowsFn rowsFn = nullptr;
+};
+
+#endif // NATIVE_H
@@ -0,0 +1,1646 @@
+#include "engine.h"
+#include "evalcache.h"
+#include "incremental.h"
+#include "native.h"
+#include "numparse.h"
+#include "server.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Подсчёт выделений памяти для замера alloc: operator new заменён во всей программе
+namespace {
+std::atomic<bool> countAllocations{false};
+std::atomic<size_t> allocationCount{0};
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    if (countAllocations.load(std::memory_order_relaxed))
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+// GCC, встроив замену в вызывающий код, принимает malloc/free за пару new/free
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+void printUsage()
+{
+    std::fprintf(stderr,
+                 "Использование: nature_bench <замер> [опции]\n"
+                 "Замеры производительности вычислительного ядра.\n\n"
+                 "Замеры:\n"
+                 "  parse [МБ]    разбор значений операндов: прежний путь\n"
+                 "                (substr + replace + std::stod) против parseNumber\n"
+                 "  alloc [N]     выделения памяти в Engine::processFile после прогрева\n"
+                 "                на N сгенерированных файлах; ошибка, если их больше нуля\n"
+                 "  fold [N]      свёртка констант и упрощения: число команд и скорость\n"
+                 "                вычисления выражения из N слагаемых до и после\n"
+                 "                Program::optimize; ошибка, если результаты различаются\n"
+                 "  cse [N]       исключение общих подвыражений: выражение из N слагаемых\n"
+                 "                вида (a+b)*(a+b)/(a+b) по таблице из 64K записей\n"
+                 "  incr [N]      изменение одного операнда в выражении из N операндов:\n"
+                 "                полное вычисление против IncrementalEvaluator::update\n"
+                 "  native [N]    машинный код против интерпретатора на выражении из N\n"
+                 "                операндов: по записи и по столбцам; ошибка, если\n"
+                 "                результаты различаются хотя бы в одном бите\n"
+                 "  symbols [N]   N определений операндов: прежняя std::map против\n"
+                 "                OperandMap на интернированных именах (чтение и связывание\n"
+                 "                слотов), затем рост времени Engine::processFile от N к 4N\n"
+                 "  validate [N]  Engine::validateFile против Engine::processFile на N\n"
+                 "                файлах без ошибок, затем число ошибок, найденных за один\n"
+                 "                проход в тех же файлах с внесёнными ошибками\n"
+                 "  precision [N] цепочка из N операндов v0 - v1/v2 - v3/v4 - ... с почти\n"
+                 "                полным сокращением: double против --precision interval и\n"
+                 "                compensated (нс на команду), значения и их границы;\n"
+                 "                ошибка, если границы режимов не пересекаются\n"
+                 "  multi [N]     N выражений над общим блоком из 10000 операндов:\n"
+                 "                N отдельных файлов против одного файла с несколькими\n"
+                 "                выражениями, в одном потоке и в пуле; ошибка, если\n"
+                 "                результаты различаются\n"
+                 "  load [--socket ПУТЬ] [--requests N] [--clients C] [--batch B]\n"
+                 "                нагрузка на сервер nature_eval --serve: C клиентов шлют\n"
+                 "                N запросов пачками по B; запросов в секунду и задержка\n"
+                 "                пачки p50/p99/max. Без --socket сервер запускается в этом\n"
+                 "                процессе; ошибка, если ответ отличается от Engine\n"
+                 "  gen [форма]   сгенерированный файл выражения в стандартный вывод\n"
+                 "  pipeline [форма] [--rounds R] [--repeat K] [--json]\n"
+                 "                этапы конвейера по отдельности и вместе: чтение выражения,\n"
+                 "                преобразование в ОПЗ, чтение операндов и вычисление;\n"
+                 "                нс на лексему, выделения памяти на проход, пиковый RSS.\n"
+                 "                --json - один объект JSON для сравнения между версиями\n\n"
+                 "Форма выражения (gen, pipeline):\n"
+                 "  --terms N       число операндов и констант в выражении (1000)\n"
+                 "  --operands N    число различных операндов (64)\n"
+                 "  --depth N       наибольшая вложенность скобок (8)\n"
+                 "  --brackets S    виды скобок, пары из ()[]{}; пусто - без скобок (()[]{})\n"
+                 "  --name-length N длина имени операнда (4)\n"
+                 "  --constants R   доля констант среди слагаемых, от 0 до 1 (0.2)\n"
+                 "  --seed N        начальное значение генератора (1)\n");
+}
+
+double secondsSince(std::chrono::steady_clock::time_point started)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+// Строки операндов "имя = значение" в разных записях: целые, ',' и '.', экспонента
+std::string makeOperandLines(size_t bytes)
+{
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> values(-1e6, 1e6);
+    std::string text;
+    text.reserve(bytes + 64);
+    char buffer[64];
+    for (size_t i = 0; text.size() < bytes; ++i) {
+        double value = values(random);
+        int length = 0;
+        switch (i % 4) {
+        case 0:
+            length = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+            break;
+        case 1:
+            length = std::snprintf(buffer, sizeof(buffer), "%.6f", value);
+            break;
+        case 2:
+            length = std::snprintf(buffer, sizeof(buffer), "%.4f", value);
+            std::replace(buffer, buffer + length, '.', ',');
+            break;
+        default:
+            length = std::snprintf(buffer, sizeof(buffer), "%.8e", value);
+            break;
+        }
+        text += "x";
+        text += std::to_string(i);
+        text += " = ";
+        text.append(buffer, length);
+        text += '\n';
+    }
+    return text;
+}
+
+// Прежний разбор из calculateRPN: копия, замена ',' и std::stod с исключениями
+double parseLegacy(const std::string &text, size_t &parsed)
+{
+    double sum = 0;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        std::string line = text.substr(begin, end - begin);
+        begin = end + 1;
+
+        size_t pos = line.find('=');
+        std::string valueStr = line.substr(pos + 1);
+        valueStr = valueStr.substr(valueStr.find_first_not_of(" \t"));
+        std::replace(valueStr.begin(), valueStr.end(), ',', '.');
+        try {
+            sum += std::stod(valueStr);
+            ++parsed;
+        } catch (const std::exception &) {
+        }
+    }
+    return sum;
+}
+
+double parseFast(std::string_view text, size_t &parsed)
+{
+    double sum = 0;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+        double value = 0;
+        if (parseNumber(line.substr(line.find('=') + 1), value)) {
+            sum += value;
+            ++parsed;
+        }
+    }
+    return sum;
+}
+
+int benchParse(int argc, char *argv[])
+{
+    size_t megabytes = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 64;
+    if (megabytes == 0)
+        megabytes = 64;
+    std::string text = makeOperandLines(megabytes << 20);
+    const double size = static_cast<double>(text.size()) / (1 << 20);
+
+    size_t legacyCount = 0;
+    auto started = std::chrono::steady_clock::now();
+    double legacySum = parseLegacy(text, legacyCount);
+    double legacySeconds = secondsSince(started);
+
+    size_t fastCount = 0;
+    started = std::chrono::steady_clock::now();
+    double fastSum = parseFast(text, fastCount);
+    double fastSeconds = secondsSince(started);
+
+    std::printf("Данные: %.1f МБ, %zu значений\n", size, fastCount);
+    std::printf("%-28s %10.1f МБ/с\n", "substr + replace + stod", size / legacySeconds);
+    std::printf("%-28s %10.1f МБ/с\n", "parseNumber", size / fastSeconds);
+    std::printf("Ускорение: %.2fx\n", legacySeconds / fastSeconds);
+
+    if (legacyCount != fastCount || legacySum != fastSum) {
+        std::fprintf(stderr, "ERROR: Результаты разбора различаются\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Файл выражения из count операндов со скобками всех видов и числовыми константами
+std::string makeExpressionFile(size_t count, std::mt19937_64 &random)
+{
+    static const char *const operators = "+-*/";
+    static const char *const opening = "([{";
+    static const char *const closing = ")]}";
+    std::string expression;
+    std::string operands;
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0)
+            expression += operators[random() % 4];
+        size_t bracket = random() % 3;
+        std::string name = "v" + std::to_string(i);
+        expression += opening[bracket];
+        expression += name;
+        expression += '+';
+        expression += std::to_string(random() % 100 + 1) + ",5";
+        expression += closing[bracket];
+        operands += name + " = " + std::to_string(random() % 1000 + 1) + "\n";
+    }
+    return expression + "\n" + operands;
+}
+
+int benchAllocations(int argc, char *argv[])
+{
+    namespace fs = std::filesystem;
+    size_t count = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 200;
+    if (count == 0)
+        count = 200;
+
+    fs::path directory = fs::temp_directory_path() / "nature_bench_alloc";
+    fs::create_directories(directory);
+    std::mt19937_64 random(7);
+    std::vector<std::string> files;
+    for (size_t i = 0; i < count; ++i) {
+        std::string name = (directory / ("expr" + std::to_string(i) + ".txt")).string();
+        std::ofstream(name) << makeExpressionFile(1 + random() % 64, random);
+        files.push_back(name);
+    }
+
+    // Прогрев: рабочая память Engine дорастает до размеров самого большого файла
+    Engine engine;
+    double sum = 0;
+    for (const std::string &file : files) {
+        double value = 0;
+        engine.processFile(file, &value);
+    }
+
+    allocationCount = 0;
+    countAllocations = true;
+    auto started = std::chrono::steady_clock::now();
+    size_t ok = 0;
+    for (const std::string &file : files) {
+        double value = 0;
+        if (engine.processFile(file, &value)) {
+            sum += value;
+            ++ok;
+        }
+    }
+    double seconds = secondsSince(started);
+    countAllocations = false;
+    size_t allocations = allocationCount;
+
+    fs::remove_all(directory);
+    std::printf("Файлов: %zu, вычислено: %zu, контрольная сумма: %g\n", count, ok, sum);
+    std::printf("Выделений памяти после прогрева: %zu (%.2f на файл)\n",
+                allocations,
+                static_cast<double>(allocations) / count);
+    std::printf("Время: %.3f с, %.1f файлов/с\n", seconds, count / seconds);
+    if (allocations != 0) {
+        std::fprintf(stderr, "ERROR: Обработка после прогрева выделяет память\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Ошибки, которые вносит замер validate: лишний оператор, лишняя или потерянная скобка,
+// испорченное значение операнда
+void breakFile(std::string &text, std::mt19937_64 &random)
+{
+    static const char *const Damage[] = {"*/", "(", ")", "]", "+"};
+    size_t expressionEnd = text.find('\n');
+    size_t errors = 1 + random() % 3;
+    for (size_t i = 0; i < errors; ++i) {
+        size_t at = random() % expressionEnd;
+        std::string damage = Damage[random() % std::size(Damage)];
+        text.insert(at, damage);
+        expressionEnd += damage.size();
+    }
+    size_t value = text.find(" = ", expressionEnd);
+    if (value != std::string::npos && random() % 2 == 0)
+        text.insert(value + 3, "x");
+}
+
+int benchValidate(int argc, char *argv[])
+{
+    namespace fs = std::filesystem;
+    size_t count = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 2000;
+    if (count == 0)
+        count = 2000;
+
+    fs::path directory = fs::temp_directory_path() / "nature_bench_validate";
+    fs::create_directories(directory);
+    std::mt19937_64 random(23);
+    std::vector<std::string> texts;
+    std::vector<std::string> files;
+    for (size_t i = 0; i < count; ++i) {
+        texts.push_back(makeExpressionFile(16 + random() % 256, random));
+        std::string name = (directory / ("expr" + std::to_string(i) + ".txt")).string();
+        std::ofstream(name) << texts.back();
+        files.push_back(name);
+    }
+
+    // Лучший из трёх проходов по всем файлам; первый заодно прогревает Engine
+    Engine engine;
+    std::vector<Diagnostic> diagnostics;
+    size_t processed = 0;
+    size_t validated = 0;
+    double processSeconds = HUGE_VAL;
+    double validateSeconds = HUGE_VAL;
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        processed = 0;
+        auto started = std::chrono::steady_clock::now();
+        for (const std::string &file : files) {
+            double value = 0;
+            processed += engine.processFile(file, &value);
+        }
+        processSeconds = std::min(processSeconds, secondsSince(started));
+
+        validated = 0;
+        started = std::chrono::steady_clock::now();
+        for (const std::string &file : files)
+            validated += engine.validateFile(file, diagnostics);
+        validateSeconds = std::min(validateSeconds, secondsSince(started));
+    }
+
+    // Файлы с ошибками: проверка находит все, обычный путь - только первую
+    size_t broken = 0;
+    size_t found = 0;
+    size_t disagreements = 0;
+    for (size_t i = 0; i < count; ++i) {
+        breakFile(texts[i], random);
+        std::ofstream(files[i]) << texts[i];
+        bool clean = engine.validateFile(files[i], diagnostics);
+        double value = 0;
+        broken += !clean;
+        found += diagnostics.size();
+        disagreements += clean != engine.processFile(files[i], &value);
+    }
+    fs::remove_all(directory);
+
+    std::printf("Файлов: %zu, без ошибок: processFile %zu, validateFile %zu\n",
+                count,
+                processed,
+                validated);
+    std::printf("%-28s %10.1f мкс на файл\n", "processFile", processSeconds * 1e6 / count);
+    std::printf("%-28s %10.1f мкс на файл\n", "validateFile", validateSeconds * 1e6 / count);
+    std::printf("Ускорение: %.2fx\n", processSeconds / validateSeconds);
+    std::printf("С внесёнными ошибками: файлов %zu, найдено ошибок %zu (%.2f на файл)\n",
+                broken,
+                found,
+                broken ? static_cast<double>(found) / broken : 0.0);
+
+    if (processed != count || validated != count || disagreements != 0) {
+        std::fprintf(stderr, "ERROR: Проверка и вычисление расходятся в оценке файлов\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Слагаемые с константными подвыражениями, унарным минусом и x*1, x/1, x-0
+std::string makeFoldableExpression(size_t terms, std::mt19937_64 &random)
+{
+    std::string expression;
+    for (size_t i = 0; i < terms; ++i) {
+        std::string name = "v" + std::to_string(i % 16);
+        std::string a = std::to_string(random() % 9 + 1);
+        std::string b = std::to_string(random() % 9 + 1);
+        if (i > 0)
+            expression += (i % 2) ? '+' : '-';
+        switch (i % 4) {
+        case 0:
+            expression += "(" + a + "*" + b + ")*" + name;
+            break;
+        case 1:
+            expression += "(-" + name + ")*1";
+            break;
+        case 2:
+            expression += "[" + name + "-0]/{" + a + "+" + b + "/2}";
+            break;
+        default:
+            expression += "(-(" + name + "/1))";
+            break;
+        }
+    }
+    return expression;
+}
+
+int benchFold(int argc, char *argv[])
+{
+    size_t terms = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 1000;
+    if (terms == 0)
+        terms = 1000;
+    constexpr size_t Rounds = 2000;
+
+    std::mt19937_64 random(11);
+    std::string expression = makeFoldableExpression(terms, random);
+    Engine engine;
+    std::string rpn;
+    Program optimized;
+    if (!engine.convertToRPN(expression, rpn, optimized)) {
+        std::fprintf(stderr, "ERROR: Сгенерированное выражение не разобрано\n");
+        return 1;
+    }
+    Program plain;
+    plain.compile(rpn);
+
+    std::uniform_real_distribution<double> values(-100, 100);
+    std::vector<double> slots(plain.variableCount());
+    std::vector<double> stack(std::max(plain.frameSize(), optimized.frameSize()) + 1);
+
+    auto run = [&](const Program &program, double &seconds) {
+        double sum = 0;
+        auto started = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < Rounds; ++round) {
+            slots[round % slots.size()] = static_cast<double>(round);
+            double value = 0;
+            program.evaluate(slots.data(), stack.data(), value);
+            sum += value;
+        }
+        seconds = secondsSince(started);
+        return sum;
+    };
+
+    for (double &slot : slots)
+        slot = values(random);
+    std::vector<double> initial = slots;
+    double plainSeconds = 0;
+    double plainSum = run(plain, plainSeconds);
+    slots = initial;
+    double optimizedSeconds = 0;
+    double optimizedSum = run(optimized, optimizedSeconds);
+
+    const double rounds = static_cast<double>(Rounds);
+    std::printf("Слагаемых: %zu, вычислений: %zu\n", terms, Rounds);
+    std::printf("%-16s %8zu команд, %8zu констант, %10.0f вычислений/с\n",
+                "без оптимизации",
+                plain.code().size(),
+                plain.constantCount(),
+                rounds / plainSeconds);
+    std::printf("%-16s %8zu команд, %8zu констант, %10.0f вычислений/с\n",
+                "optimize",
+                optimized.code().size(),
+                optimized.constantCount(),
+                rounds / optimizedSeconds);
+    std::printf("Команд выполнено меньше в %.2f раза, ускорение: %.2fx\n",
+                static_cast<double>(plain.code().size()) / optimized.code().size(),
+                plainSeconds / optimizedSeconds);
+
+    if (std::memcmp(&plainSum, &optimizedSum, sizeof(double)) != 0) {
+        std::fprintf(stderr, "ERROR: Результаты до и после оптимизации различаются\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Слагаемые с многократно повторяющимися подвыражениями из небольшого набора операндов
+std::string makeRepeatedExpression(size_t terms)
+{
+    std::string expression;
+    for (size_t i = 0; i < terms; ++i) {
+        std::string a = "v" + std::to_string(i % 8);
+        std::string b = "v" + std::to_string((i / 8) % 8);
+        std::string sum = "(" + a + "+" + b + ")";
+        if (i > 0)
+            expression += '+';
+        expression += "[" + sum + "*" + sum + "/{" + b + "+" + a + "+1}]";
+    }
+    return expression;
+}
+
+int benchCse(int argc, char *argv[])
+{
+    size_t terms = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 256;
+    if (terms == 0)
+        terms = 256;
+    constexpr size_t Rows = 1 << 16;
+
+    Engine engine;
+    std::string rpn;
+    Program optimized;
+    if (!engine.convertToRPN(makeRepeatedExpression(terms), rpn, optimized)) {
+        std::fprintf(stderr, "ERROR: Сгенерированное выражение не разобрано\n");
+        return 1;
+    }
+    Program plain;
+    plain.compile(rpn);
+
+    std::mt19937_64 random(5);
+    std::uniform_real_distribution<double> values(1, 100);
+    std::vector<double> table(Rows * plain.variableCount());
+    for (double &value : table)
+        value = values(random);
+    std::vector<double> stack(std::max(plain.frameSize(), optimized.frameSize()) + 1);
+
+    auto run = [&](const Program &program, double &seconds) {
+        double sum = 0;
+        auto started = std::chrono::steady_clock::now();
+        for (size_t row = 0; row < Rows; ++row) {
+            double value = 0;
+            program.evaluate(table.data() + row * program.variableCount(), stack.data(), value);
+            sum += value;
+        }
+        seconds = secondsSince(started);
+        return sum;
+    };
+
+    double plainSeconds = 0;
+    double plainSum = run(plain, plainSeconds);
+    double optimizedSeconds = 0;
+    double optimizedSum = run(optimized, optimizedSeconds);
+
+    std::printf("Слагаемых: %zu, записей: %zu\n", terms, Rows);
+    std::printf("%-16s %8zu команд, %6zu ячеек, %10.0f записей/с\n",
+                "плоская ОПЗ",
+                plain.code().size(),
+                plain.tempCount(),
+                Rows / plainSeconds);
+    std::printf("%-16s %8zu команд, %6zu ячеек, %10.0f записей/с\n",
+                "DAG",
+                optimized.code().size(),
+                optimized.tempCount(),
+                Rows / optimizedSeconds);
+    std::printf("Команд меньше в %.2f раза, ускорение: %.2fx\n",
+                static_cast<double>(plain.code().size()) / optimized.code().size(),
+                plainSeconds / optimizedSeconds);
+
+    // a+b и b+a в IEEE равны точно, поэтому и суммы должны совпасть побитово
+    if (std::memcmp(&plainSum, &optimizedSum, sizeof(double)) != 0) {
+        std::fprintf(stderr, "ERROR: Результаты до и после оптимизации различаются\n");
+        return 1;
+    }
+    return 0;
+}
+
+// v0 - v1/v2 - v3/v4 - ...; v0 подобран так, что результат почти сокращается
+std::string makeCancellingExpression(size_t terms)
+{
+    std::string expression = "v0";
+    for (size_t i = 1; i + 1 < terms; i += 2)
+        expression += "-v" + std::to_string(i) + "/v" + std::to_string(i + 1);
+    return expression;
+}
+
+int benchPrecision(int argc, char *argv[])
+{
+    size_t terms = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 1000;
+    if (terms < 3)
+        terms = 1000;
+    constexpr size_t Rounds = 200;
+
+    // Свёртка только точная, как в режимах с оценкой погрешности
+    Engine engine;
+    engine.setPrecision(Precision::Interval);
+    std::string rpn;
+    Program program;
+    if (!engine.convertToRPN(makeCancellingExpression(terms), rpn, program)) {
+        std::fprintf(stderr, "ERROR: Сгенерированное выражение не разобрано\n");
+        return 1;
+    }
+
+    // Частные складываются в double в том же порядке, что и при вычислении,
+    // и v0 больше их суммы на 1e-6: почти все знаки слагаемых сокращаются
+    std::mt19937_64 random(31);
+    std::uniform_real_distribution<double> values(1, 10);
+    std::vector<double> slots(program.variableCount());
+    std::vector<double> stack(program.frameSize() + 1);
+    double sum = 0;
+    for (size_t i = 1; i + 1 < terms; i += 2) {
+        const int dividend = program.findVariable("v" + std::to_string(i));
+        const int divisor = program.findVariable("v" + std::to_string(i + 1));
+        slots[dividend] = values(random);
+        slots[divisor] = values(random);
+        sum += slots[dividend] / slots[divisor];
+    }
+    slots[program.findVariable("v0")] = sum + 1e-6;
+
+    // Лучший из пяти повторов
+    PreciseEvaluator evaluator;
+    double plainValue = 0;
+    PreciseResult interval;
+    PreciseResult compensated;
+    auto best = [&](const std::function<void()> &evaluate) {
+        double seconds = HUGE_VAL;
+        for (int repeat = 0; repeat < 5; ++repeat) {
+            auto started = std::chrono::steady_clock::now();
+            for (size_t round = 0; round < Rounds; ++round)
+                evaluate();
+            seconds = std::min(seconds, secondsSince(started));
+        }
+        return seconds * 1e9 / (static_cast<double>(Rounds) * program.code().size());
+    };
+    const double plainNs = best([&] { program.evaluate(slots.data(), stack.data(), plainValue); });
+    const double intervalNs = best([&] {
+        evaluator.evaluate(program, slots.data(), Precision::Interval, interval);
+    });
+    const double compensatedNs = best([&] {
+        evaluator.evaluate(program, slots.data(), Precision::Compensated, compensated);
+    });
+
+    std::printf("Операндов: %zu, команд: %zu, вычислений: %zu\n",
+                program.variableCount(),
+                program.code().size(),
+                Rounds);
+    std::printf("%-12s %8.2f нс на команду\n", "double", plainNs);
+    std::printf("%-12s %8.2f нс на команду, %.1fx от double\n",
+                "interval",
+                intervalNs,
+                intervalNs / plainNs);
+    std::printf("%-12s %8.2f нс на команду, %.1fx от double\n",
+                "compensated",
+                compensatedNs,
+                compensatedNs / plainNs);
+    std::printf("%-12s %s\n", "double", Engine::formatDouble(plainValue).c_str());
+    std::printf("%-12s %s\n",
+                "interval",
+                Engine::formatPrecise(interval.value, interval.bound).c_str());
+    std::printf("%-12s %s\n",
+                "compensated",
+                Engine::formatPrecise(compensated.value, compensated.bound).c_str());
+    // Погрешность double не больше расстояния до значения compensated плюс его граница
+    const double error = std::fabs(plainValue - compensated.value) + compensated.bound;
+    std::printf("Верных значащих цифр у double: %.1f, граница interval: %.1f\n",
+                std::clamp(-std::log10(error / std::fabs(compensated.value)), 0.0, 17.0),
+                std::clamp(-std::log10(interval.bound / std::fabs(interval.value)), 0.0, 17.0));
+
+    // Оба режима гарантируют, что точное значение внутри границы: отрезки пересекаются
+    if (std::memcmp(&plainValue, &interval.value, sizeof(double)) != 0
+        || !(std::fabs(interval.value - compensated.value)
+             <= interval.bound + compensated.bound)) {
+        std::fprintf(stderr, "ERROR: Границы interval и compensated не согласованы\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Выражение из terms операндов общего блока из operands имён
+std::string makeSharedExpression(size_t terms, size_t operands, std::mt19937_64 &random)
+{
+    static const char *const operators = "+-*";
+    std::string expression;
+    for (size_t i = 0; i < terms; ++i) {
+        if (i > 0)
+            expression += operators[random() % 3];
+        expression += "(v" + std::to_string(random() % operands) + "+1,5)";
+    }
+    return expression;
+}
+
+int benchMulti(int argc, char *argv[])
+{
+    namespace fs = std::filesystem;
+    size_t count = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 500;
+    if (count == 0)
+        count = 500;
+    constexpr size_t Operands = 10000;
+    constexpr size_t Terms = 16;
+
+    // Одни и те же выражения: по файлу на каждое с полным блоком операндов
+    // и один файл со всеми выражениями и общим блоком
+    std::mt19937_64 random(41);
+    std::string operandLines;
+    for (size_t i = 0; i < Operands; ++i)
+        operandLines += "v" + std::to_string(i) + " = " + std::to_string(random() % 1000) + ",25\n";
+    fs::path directory = fs::temp_directory_path() / "nature_bench_multi";
+    fs::create_directories(directory);
+    std::vector<std::string> files;
+    std::string combined;
+    for (size_t i = 0; i < count; ++i) {
+        const std::string expression = makeSharedExpression(Terms, Operands, random);
+        files.push_back((directory / ("expr" + std::to_string(i) + ".txt")).string());
+        std::ofstream(files.back()) << expression << '\n' << operandLines;
+        combined += "e" + std::to_string(i) + ": " + expression + '\n';
+    }
+    const std::string multiFile = (directory / "all.txt").string();
+    std::ofstream(multiFile) << combined << '\n' << operandLines;
+
+    // Лучший из трёх проходов; первый заодно прогревает Engine
+    Engine engine;
+    ThreadPool pool(ThreadPool::hardwareThreads());
+    std::vector<double> single(count);
+    double singleSeconds = HUGE_VAL;
+    double multiSeconds = HUGE_VAL;
+    double parallelSeconds = HUGE_VAL;
+    bool ok = true;
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i)
+            ok = engine.processFile(files[i], &single[i]) && ok;
+        singleSeconds = std::min(singleSeconds, secondsSince(started));
+
+        engine.setPool(nullptr);
+        started = std::chrono::steady_clock::now();
+        ok = engine.processFile(multiFile) && ok;
+        multiSeconds = std::min(multiSeconds, secondsSince(started));
+
+        engine.setPool(&pool);
+        started = std::chrono::steady_clock::now();
+        ok = engine.processFile(multiFile) && ok;
+        parallelSeconds = std::min(parallelSeconds, secondsSince(started));
+    }
+    fs::remove_all(directory);
+
+    // Результаты совпадают побитово: набор вычисляет те же программы
+    const ExpressionSet &set = engine.expressions();
+    size_t mismatches = set.size() == count ? 0 : count;
+    for (size_t i = 0; i < set.size() && i < count; ++i) {
+        const double value = set.result(i).value;
+        mismatches += set.result(i).status != EvalStatus::Ok
+                      || std::memcmp(&value, &single[i], sizeof(double)) != 0;
+    }
+
+    std::printf("Выражений: %zu по %zu операндов, общий блок из %zu операндов\n",
+                count,
+                Terms,
+                Operands);
+    std::printf("%-28s %10.1f мкс на выражение\n", "processFile x N", singleSeconds * 1e6 / count);
+    std::printf("%-28s %10.1f мкс на выражение, %.1fx\n",
+                "ExpressionSet",
+                multiSeconds * 1e6 / count,
+                singleSeconds / multiSeconds);
+    std::printf("%-28s %10.1f мкс на выражение, %.1fx (%zu потоков)\n",
+                "ExpressionSet + ThreadPool",
+                parallelSeconds * 1e6 / count,
+                singleSeconds / parallelSeconds,
+                pool.threadCount());
+
+    if (!ok || mismatches != 0) {
+        std::fprintf(stderr, "ERROR: Результаты файла с несколькими выражениями различаются\n");
+        return 1;
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+constexpr int SendFlags = 0;
+#endif
+
+// Сервер в этом процессе мог ещё не открыть сокет: попытки в течение секунды
+int connectServer(const std::string &path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+    std::copy(path.begin(), path.end(), address.sun_path);
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+            return fd;
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return -1;
+}
+
+// Ответ на пачку читается до строки "." каждого запроса
+bool exchange(int fd, std::string_view batch, size_t requests, std::string &response)
+{
+    for (size_t sent = 0; sent < batch.size();) {
+        const ssize_t n = send(fd, batch.data() + sent, batch.size() - sent, SendFlags);
+        if (n <= 0)
+            return false;
+        sent += static_cast<size_t>(n);
+    }
+    response.clear();
+    size_t scanned = 0;
+    char buffer[16 * 1024];
+    while (requests > 0) {
+        const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            return false;
+        response.append(buffer, static_cast<size_t>(n));
+        for (size_t end; requests > 0 && (end = response.find('\n', scanned)) != std::string::npos;
+             scanned = end + 1) {
+            requests -= response.compare(scanned, end - scanned, ".") == 0;
+        }
+    }
+    return true;
+}
+
+// Запрос из небольшой формулы и её операндов; одна формула из 16 делит на ноль,
+// чтобы под нагрузкой проходил и путь ошибки
+std::string makeRequest(std::mt19937_64 &random)
+{
+    static const char *const formulas[] = {"x*y+z",
+                                           "(x+y)*(z-w)",
+                                           "x/y-z*w",
+                                           "x^2+y^2",
+                                           "sqrt(x*x+y*y)",
+                                           "(x-y)/(z+w+1)",
+                                           "x*(y+z*(w+1))",
+                                           "max(x;y)-min(z;w)",
+                                           "abs(x-y)+abs(z-w)",
+                                           "x+y+z+w",
+                                           "[x+y]*{z-w}",
+                                           "x*y*z/(w+1)",
+                                           "(x+1)*(y+2)*(z+3)",
+                                           "x-y*2,5+z/4",
+                                           "x/(y-y)",
+                                           "sum: x+y\nproduct: x*y"};
+    std::string request = formulas[random() % std::size(formulas)];
+    request += "\n\n";
+    for (const char *name : {"x", "y", "z", "w"})
+        request += std::string(name) + " = " + std::to_string(random() % 1000) + ",25\n";
+    return request + ".\n";
+}
+
+int benchLoad(int argc, char *argv[])
+{
+    std::string socketPath;
+    size_t requests = 20000;
+    size_t clients = 4;
+    size_t batch = 1;
+    for (int i = 0; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if ((std::strcmp(argv[i], "--requests") == 0
+                    || std::strcmp(argv[i], "--clients") == 0
+                    || std::strcmp(argv[i], "--batch") == 0)
+                   && i + 1 < argc) {
+            size_t &target = std::strcmp(argv[i], "--requests") == 0  ? requests
+                             : std::strcmp(argv[i], "--clients") == 0 ? clients
+                                                                      : batch;
+            target = std::strtoul(argv[++i], nullptr, 10);
+            if (target == 0) {
+                std::fprintf(stderr, "ERROR: Некорректное значение %s\n", argv[i - 1]);
+                return 2;
+            }
+        } else {
+            std::fprintf(stderr, "ERROR: Неизвестная опция: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // Ожидаемые ответы - от обработчика того же сервера без сокета
+    std::mt19937_64 random(43);
+    std::vector<std::string> texts(requests);
+    std::vector<std::string> expected(requests);
+    {
+        Engine engine;
+        EvalServer local(engine);
+        for (size_t i = 0; i < requests; ++i) {
+            texts[i] = makeRequest(random);
+            local.handle(std::string_view(texts[i]).substr(0, texts[i].size() - 2), expected[i]);
+        }
+    }
+
+    // Сервер в отдельном потоке, если не задан внешний
+    Engine engine;
+    EvalCache cache;
+    engine.setCache(&cache);
+    EvalServer server(engine);
+    std::thread serverThread;
+    std::string serverError;
+    bool serverOk = true;
+    if (socketPath.empty()) {
+        socketPath = (std::filesystem::temp_directory_path()
+                      / ("nature_bench_" + std::to_string(getpid()) + ".sock"))
+                         .string();
+        serverThread = std::thread(
+            [&] { serverOk = server.serveSocket(socketPath, serverError); });
+    }
+
+    // Клиент c шлёт запросы c, c + C, c + 2C ... пачками по batch
+    std::vector<std::vector<double>> latencies(clients);
+    std::atomic<size_t> mismatches{0};
+    std::atomic<size_t> failures{0};
+    std::vector<std::thread> threads;
+    const auto started = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            const int fd = connectServer(socketPath);
+            if (fd < 0) {
+                ++failures;
+                return;
+            }
+            std::string request;
+            std::string want;
+            std::string response;
+            for (size_t first = c; first < requests; first += batch * clients) {
+                request.clear();
+                want.clear();
+                size_t count = 0;
+                for (size_t i = first; i < requests && count < batch; i += clients, ++count) {
+                    request += texts[i];
+                    want += expected[i];
+                }
+                const auto sent = std::chrono::steady_clock::now();
+                if (!exchange(fd, request, count, response)) {
+                    ++failures;
+                    break;
+                }
+                latencies[c].push_back(secondsSince(sent));
+                mismatches += response != want;
+            }
+            close(fd);
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    const double seconds = secondsSince(started);
+    if (serverThread.joinable()) {
+        server.stop();
+        serverThread.join();
+    }
+    if (!serverOk)
+        std::fprintf(stderr, "%s\n", serverError.c_str());
+
+    std::vector<double> all;
+    for (const std::vector<double> &client : latencies)
+        all.insert(all.end(), client.begin(), client.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](size_t p) {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, all.size() * p / 100)] * 1e6;
+    };
+    std::printf("Запросов: %zu, клиентов: %zu, в пачке: %zu\n", requests, clients, batch);
+    std::printf("%-12s %12.0f запросов/с\n", "throughput", requests / seconds);
+    std::printf("%-12s %12.1f мкс на пачку\n", "p50", percentile(50));
+    std::printf("%-12s %12.1f мкс на пачку\n", "p99", percentile(99));
+    std::printf("%-12s %12.1f мкс на пачку\n", "max", all.empty() ? 0.0 : all.back() * 1e6);
+
+    if (!serverOk || failures != 0 || mismatches != 0) {
+        std::fprintf(stderr,
+                     "ERROR: Ответы сервера: %zu пачек различаются, %zu клиентов не обслужены\n",
+                     mismatches.load(),
+                     failures.load());
+        return 1;
+    }
+    return 0;
+}
+#else
+int benchLoad(int, char *[])
+{
+    std::fprintf(stderr, "ERROR: Замер сервера на этой платформе не поддерживается\n");
+    return 2;
+}
+#endif
+
+int benchIncremental(int argc, char *argv[])
+{
+    size_t count = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 10000;
+    if (count == 0)
+        count = 10000;
+    constexpr size_t Rounds = 2000;
+
+    // Выражение из makeExpressionFile: изменение операнда пересчитывает его узлы
+    // и их потребителей до корня, остальная часть выражения не трогается
+    std::mt19937_64 random(9);
+    std::string expression = makeExpressionFile(count, random);
+    expression.resize(expression.find('\n'));
+    Engine engine;
+    std::string rpn;
+    Program program;
+    if (!engine.convertToRPN(expression, rpn, program) || !program.isWellFormed()) {
+        std::fprintf(stderr, "ERROR: Сгенерированное выражение не разобрано\n");
+        return 1;
+    }
+
+    std::uniform_real_distribution<double> values(1, 1000);
+    std::vector<double> slots(program.variableCount());
+    for (double &slot : slots)
+        slot = values(random);
+    std::vector<double> stack(program.frameSize() + 1);
+    IncrementalEvaluator incremental;
+    incremental.reset(program, slots.data());
+
+    double fullSum = 0;
+    double incrementalSum = 0;
+    size_t recomputed = 0;
+    size_t mismatches = 0;
+    double fullSeconds = 0;
+    double incrementalSeconds = 0;
+    for (size_t round = 0; round < Rounds; ++round) {
+        size_t slot = random() % slots.size();
+        slots[slot] = values(random);
+
+        double full = 0;
+        auto started = std::chrono::steady_clock::now();
+        EvalStatus fullStatus = program.evaluate(slots.data(), stack.data(), full);
+        fullSeconds += secondsSince(started);
+
+        double value = 0;
+        started = std::chrono::steady_clock::now();
+        incremental.setOperand(slot, slots[slot]);
+        EvalStatus status = incremental.update(value);
+        incrementalSeconds += secondsSince(started);
+        recomputed += incremental.recomputedCount();
+
+        if (status != fullStatus
+            || (status == EvalStatus::Ok && std::memcmp(&full, &value, sizeof(double)) != 0))
+            ++mismatches;
+        fullSum += full;
+        incrementalSum += value;
+    }
+
+    std::printf("Операндов: %zu, узлов: %zu, изменений: %zu\n",
+                slots.size(),
+                incremental.nodeCount(),
+                Rounds);
+    std::printf("%-24s %10.2f мкс на изменение\n", "полное вычисление", fullSeconds / Rounds * 1e6);
+    std::printf("%-24s %10.2f мкс на изменение, %.1f узлов\n",
+                "IncrementalEvaluator",
+                incrementalSeconds / Rounds * 1e6,
+                static_cast<double>(recomputed) / Rounds);
+    std::printf("Ускорение: %.1fx\n", fullSeconds / incrementalSeconds);
+    if (mismatches != 0) {
+        std::fprintf(stderr, "ERROR: Результаты различаются в %zu изменениях\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
+
+int benchNative(int argc, char *argv[])
+{
+    size_t count = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 64;
+    if (count == 0)
+        count = 64;
+    constexpr size_t Rows = 1 << 18;
+
+    std::mt19937_64 random(13);
+    std::string expression = makeExpressionFile(count, random);
+    expression.resize(expression.find('\n'));
+    Engine engine;
+    std::string rpn;
+    Program program;
+    if (!engine.convertToRPN(expression, rpn, program) || !program.isWellFormed()) {
+        std::fprintf(stderr, "ERROR: Сгенерированное выражение не разобрано\n");
+        return 1;
+    }
+
+    NativeProgram native;
+    std::string error;
+    auto started = std::chrono::steady_clock::now();
+    if (!native.build(program, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::printf("Операндов: %zu, команд: %zu, сборка: %.3f с\n",
+                program.variableCount(),
+                program.code().size(),
+                secondsSince(started));
+
+    // Слагаемые выражения имеют вид (vN+K,5): значения -K,5 в 1/64 строк иногда
+    // обращают делитель в ноль, так что проверяется и деление на ноль
+    std::uniform_real_distribution<double> values(-1000, 1000);
+    std::vector<std::vector<double>> columns(program.variableCount(), std::vector<double>(Rows));
+    std::vector<const double *> sources;
+    for (std::vector<double> &column : columns) {
+        for (double &value : column)
+            value = random() % 64 == 0 ? -(random() % 100 + 1.5) : values(random);
+        sources.push_back(column.data());
+    }
+    std::vector<double> scalars(program.variableCount());
+    std::vector<double> slots(program.variableCount());
+    std::vector<double> stack(program.frameSize() + 1);
+
+    std::vector<double> interpreted(Rows);
+    std::vector<std::uint8_t> interpretedFailed(Rows);
+    started = std::chrono::steady_clock::now();
+    for (size_t row = 0; row < Rows; ++row) {
+        for (size_t slot = 0; slot < slots.size(); ++slot)
+            slots[slot] = columns[slot][row];
+        interpretedFailed[row]
+            = program.evaluate(slots.data(), stack.data(), interpreted[row]) != EvalStatus::Ok;
+    }
+    double interpreterSeconds = secondsSince(started);
+
+    std::vector<double> compiled(Rows);
+    std::vector<std::uint8_t> compiledFailed(Rows);
+    started = std::chrono::steady_clock::now();
+    for (size_t row = 0; row < Rows; ++row) {
+        for (size_t slot = 0; slot < slots.size(); ++slot)
+            slots[slot] = columns[slot][row];
+        compiledFailed[row] = native.evaluate(slots.data(), compiled[row]) != EvalStatus::Ok;
+    }
+    double nativeSeconds = secondsSince(started);
+
+    std::vector<double> rows(Rows);
+    std::vector<std::uint8_t> rowsFailed(Rows);
+    started = std::chrono::steady_clock::now();
+    native.evaluateRows(sources.data(), scalars.data(), 0, Rows, rows.data(), rowsFailed.data());
+    double rowsSeconds = secondsSince(started);
+
+    size_t mismatches = 0;
+    size_t failures = 0;
+    for (size_t row = 0; row < Rows; ++row) {
+        failures += interpretedFailed[row];
+        if (interpretedFailed[row] != compiledFailed[row]
+            || interpretedFailed[row] != rowsFailed[row])
+            ++mismatches;
+        else if (!interpretedFailed[row]
+                 && (std::memcmp(&interpreted[row], &compiled[row], sizeof(double)) != 0
+                     || std::memcmp(&interpreted[row], &rows[row], sizeof(double)) != 0))
+            ++mismatches;
+    }
+
+    const double million = Rows / 1e6;
+    std::printf("Записей: %zu, делений на ноль: %zu\n", Rows, failures);
+    std::printf("%-28s %8.2f млн записей/с\n", "Program::evaluate", million / interpreterSeconds);
+    std::printf("%-28s %8.2f млн записей/с\n", "NativeProgram::evaluate", million / nativeSeconds);
+    std::printf("%-28s %8.2f млн записей/с\n",
+                "NativeProgram::evaluateRows",
+                million / rowsSeconds);
+    if (mismatches != 0) {
+        std::fprintf(stderr, "ERROR: Результаты различаются в %zu записях\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
+
+// Выражение-сумма из count операндов с длинными общими префиксами имён
+// и строки их определений в перемешанном порядке
+std::string makeDefinitionsFile(size_t count, std::mt19937_64 &random)
+{
+    std::vector<size_t> order(count);
+    std::string text;
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = i;
+        text += i ? "+operand_" : "operand_";
+        text += std::to_string(i);
+    }
+    text += '\n';
+    std::shuffle(order.begin(), order.end(), random);
+    for (size_t i : order)
+        text += "operand_" + std::to_string(i) + " = " + std::to_string(i % 1000) + ",25\n";
+    return text;
+}
+
+int benchSymbols(int argc, char *argv[])
+{
+    namespace fs = std::filesystem;
+    size_t count = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 100000;
+    if (count == 0)
+        count = 100000;
+
+    std::mt19937_64 random(17);
+    const std::string file = makeDefinitionsFile(count, random);
+    Engine engine;
+    std::string_view text = file;
+    std::string_view expression;
+    std::string rpn;
+    Program program;
+    if (!engine.readExpression(text, expression) || !engine.convertToRPN(expression, rpn, program)) {
+        std::fprintf(stderr, "ERROR: Сгенерированное выражение не разобрано\n");
+        return 1;
+    }
+    std::vector<double> legacySlots(program.variableCount());
+    std::vector<double> slots(program.variableCount());
+
+    // Прежний путь: дерево строк и поиск по нему для каждого слота
+    auto started = std::chrono::steady_clock::now();
+    std::map<std::string, double, std::less<>> legacy;
+    std::string_view lines = text;
+    while (!lines.empty()) {
+        size_t end = lines.find('\n');
+        std::string_view line = lines.substr(0, end);
+        lines.remove_prefix(end == std::string_view::npos ? lines.size() : end + 1);
+        size_t pos = line.find('=');
+        double value = 0;
+        parseNumber(line.substr(pos + 2), value);
+        legacy[std::string(line.substr(0, pos - 1))] = value;
+    }
+    for (size_t slot = 0; slot < legacySlots.size(); ++slot)
+        legacySlots[slot] = legacy.find(program.variableName(slot))->second;
+    double legacySeconds = secondsSince(started);
+
+    started = std::chrono::steady_clock::now();
+    OperandMap operands;
+    if (!engine.readOperands(text, operands)) {
+        std::fprintf(stderr, "ERROR: Определения операндов не прочитаны\n");
+        return 1;
+    }
+    size_t missing = program.bind(operands, slots.data());
+    double symbolSeconds = secondsSince(started);
+
+    // Полная обработка файла: время на операнд не должно расти вместе с их числом
+    fs::path directory = fs::temp_directory_path() / "nature_bench_symbols";
+    fs::create_directories(directory);
+    double perOperand[2] = {0, 0};
+    for (size_t i = 0; i < 2; ++i) {
+        size_t n = count << (2 * i);
+        std::string name = (directory / ("defs" + std::to_string(n) + ".txt")).string();
+        std::ofstream(name) << makeDefinitionsFile(n, random);
+        double value = 0;
+        started = std::chrono::steady_clock::now();
+        bool ok = engine.processFile(name, &value);
+        perOperand[i] = secondsSince(started) * 1e9 / n;
+        if (!ok) {
+            std::fprintf(stderr, "ERROR: Файл из %zu операндов не вычислен\n", n);
+            fs::remove_all(directory);
+            return 1;
+        }
+    }
+    fs::remove_all(directory);
+
+    std::printf("Операндов: %zu\n", count);
+    std::printf("%-28s %10.1f нс на операнд\n", "std::map", legacySeconds * 1e9 / count);
+    std::printf("%-28s %10.1f нс на операнд\n", "OperandMap", symbolSeconds * 1e9 / count);
+    std::printf("Ускорение: %.2fx\n", legacySeconds / symbolSeconds);
+    std::printf("processFile: %.1f нс на операнд при %zu, %.1f при %zu (рост %.2fx)\n",
+                perOperand[0],
+                count,
+                perOperand[1],
+                count * 4,
+                perOperand[1] / perOperand[0]);
+
+    if (missing != 0
+        || std::memcmp(legacySlots.data(), slots.data(), slots.size() * sizeof(double)) != 0) {
+        std::fprintf(stderr, "ERROR: Значения слотов различаются\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Форма сгенерированного выражения для gen и pipeline
+struct Shape
+{
+    size_t terms = 1000;
+    size_t operands = 64;
+    size_t depth = 8;
+    std::string brackets = "()[]{}";
+    size_t nameLength = 4;
+    double constants = 0.2;
+    std::uint64_t seed = 1;
+};
+
+// Разбирает опцию формы в argv[i]; false и error - опция формы, но с ошибкой.
+// handled = false - опция не относится к форме
+bool parseShapeOption(
+    int argc, char *argv[], int &i, Shape &shape, bool &handled, std::string &error)
+{
+    static const char *const Options[] = {"--terms",
+                                          "--operands",
+                                          "--depth",
+                                          "--brackets",
+                                          "--name-length",
+                                          "--constants",
+                                          "--seed"};
+    handled = std::find_if(std::begin(Options),
+                           std::end(Options),
+                           [&](const char *option) { return std::strcmp(argv[i], option) == 0; })
+              != std::end(Options);
+    if (!handled)
+        return true;
+    if (i + 1 >= argc) {
+        error = std::string("ERROR: Не указано значение для ") + argv[i];
+        return false;
+    }
+    std::string option = argv[i];
+    const char *value = argv[++i];
+    char *end = nullptr;
+    if (option == "--brackets") {
+        shape.brackets = value;
+        if (shape.brackets.size() % 2 != 0) {
+            error = "ERROR: Скобки задаются парами: " + shape.brackets;
+            return false;
+        }
+        for (size_t k = 0; k < shape.brackets.size(); k += 2) {
+            std::string pair = shape.brackets.substr(k, 2);
+            if (pair != "()" && pair != "[]" && pair != "{}") {
+                error = "ERROR: Неизвестная пара скобок: " + pair;
+                return false;
+            }
+        }
+        return true;
+    }
+    if (option == "--constants") {
+        shape.constants = std::strtod(value, &end);
+        if (*end != '\0' || !(shape.constants >= 0 && shape.constants <= 1)) {
+            error = std::string("ERROR: Доля констант должна быть от 0 до 1: ") + value;
+            return false;
+        }
+        return true;
+    }
+    unsigned long long number = std::strtoull(value, &end, 10);
+    if (*end != '\0' || *value == '\0' || *value == '-') {
+        error = "ERROR: Некорректное значение " + option + ": " + value;
+        return false;
+    }
+    if (option == "--seed") {
+        shape.seed = number;
+        return true;
+    }
+    if (number == 0 && option != "--depth") {
+        error = "ERROR: Значение " + option + " должно быть больше нуля";
+        return false;
+    }
+    if (option == "--terms")
+        shape.terms = number;
+    else if (option == "--operands")
+        shape.operands = number;
+    else if (option == "--depth")
+        shape.depth = number;
+    else
+        shape.nameLength = number;
+    return true;
+}
+
+class ShapedGenerator
+{
+public:
+    explicit ShapedGenerator(const Shape &shape)
+        : shape(shape)
+        , random(shape.seed)
+    {
+        for (size_t i = 0; i < shape.operands; ++i) {
+            std::string name = "v" + std::to_string(i);
+            if (name.size() < shape.nameLength)
+                name.append(shape.nameLength - name.size(), 'x');
+            names.push_back(name);
+        }
+    }
+
+    // Первая строка - выражение, за ней строки операндов; tokens - число лексем выражения
+    std::string file(size_t &tokens)
+    {
+        std::string text;
+        this->tokens = 0;
+        group(shape.terms, shape.depth, text);
+        tokens = this->tokens;
+        text += '\n';
+        std::uniform_real_distribution<double> values(1, 1000);
+        char buffer[32];
+        for (const std::string &name : names) {
+            std::snprintf(buffer, sizeof(buffer), "%.6f", values(random));
+            text += name + " = " + buffer + "\n";
+        }
+        return text;
+    }
+
+private:
+    // leaves слагаемых; на каждом уровне они делятся на равные группы в скобках
+    // так, чтобы вложенность дошла до depth к отдельным слагаемым
+    void group(size_t leaves, size_t depth, std::string &out)
+    {
+        if (depth == 0 || leaves < 2 || shape.brackets.empty()) {
+            for (size_t i = 0; i < leaves; ++i) {
+                if (i > 0)
+                    op(out);
+                leaf(out);
+            }
+            return;
+        }
+        double root = std::pow(static_cast<double>(leaves), 1.0 / (depth + 1));
+        size_t parts = std::clamp<size_t>(static_cast<size_t>(std::lround(root)), 2, leaves);
+        for (size_t i = 0; i < parts; ++i) {
+            size_t size = leaves * (i + 1) / parts - leaves * i / parts;
+            if (i > 0)
+                op(out);
+            if (size == 1) {
+                leaf(out);
+                continue;
+            }
+            size_t pair = random() % (shape.brackets.size() / 2) * 2;
+            out += shape.brackets[pair];
+            group(size, depth - 1, out);
+            out += shape.brackets[pair + 1];
+            tokens += 2;
+        }
+    }
+
+    void op(std::string &out)
+    {
+        out += "+-*/"[random() % 4];
+        ++tokens;
+    }
+
+    void leaf(std::string &out)
+    {
+        if (std::uniform_real_distribution<double>(0, 1)(random) < shape.constants)
+            out += std::to_string(random() % 99 + 1) + ",5";
+        else
+            out += names[random() % names.size()];
+        ++tokens;
+    }
+
+    const Shape &shape;
+    std::mt19937_64 random;
+    std::vector<std::string> names;
+    size_t tokens = 0;
+};
+
+int benchGenerate(int argc, char *argv[])
+{
+    Shape shape;
+    std::string error;
+    for (int i = 0; i < argc; ++i) {
+        bool handled = false;
+        if (!parseShapeOption(argc, argv, i, shape, handled, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        if (!handled) {
+            std::fprintf(stderr, "ERROR: Неизвестная опция: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    size_t tokens = 0;
+    std::string text = ShapedGenerator(shape).file(tokens);
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    return 0;
+}
+
+// Пиковый размер резидентной памяти процесса в КБ; 0 - неизвестен
+size_t peakResidentKilobytes()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+int benchPipeline(int argc, char *argv[])
+{
+    Shape shape;
+    size_t rounds = 200;
+    size_t repeats = 5;
+    bool json = false;
+    std::string error;
+    for (int i = 0; i < argc; ++i) {
+        bool handled = false;
+        if (!parseShapeOption(argc, argv, i, shape, handled, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        if (handled)
+            continue;
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if ((std::strcmp(argv[i], "--rounds") == 0 || std::strcmp(argv[i], "--repeat") == 0)
+                   && i + 1 < argc) {
+            size_t &target = std::strcmp(argv[i], "--rounds") == 0 ? rounds : repeats;
+            target = std::strtoul(argv[++i], nullptr, 10);
+            if (target == 0) {
+                std::fprintf(stderr, "ERROR: Некорректное значение %s\n", argv[i - 1]);
+                return 2;
+            }
+        } else {
+            std::fprintf(stderr, "ERROR: Неизвестная опция: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    size_t tokens = 0;
+    const std::string file = ShapedGenerator(shape).file(tokens);
+
+    Engine engine;
+    std::string_view text;
+    std::string_view expression;
+    std::string rpn;
+    Program program;
+    OperandMap operands;
+    double result = 0;
+    auto read = [&] {
+        text = file;
+        return engine.readExpression(text, expression);
+    };
+    auto convert = [&] {
+        rpn.clear();
+        return engine.convertToRPN(expression, rpn, program);
+    };
+    auto calculate = [&] {
+        return engine.readOperands(text, operands) && engine.evaluate(program, operands, &result);
+    };
+    auto total = [&] { return read() && convert() && calculate(); };
+
+    // Прогрев: рабочая память Engine, ОПЗ и таблица операндов дорастают до нужных размеров
+    if (!read() || !convert()) {
+        std::fprintf(stderr, "ERROR: Сгенерированное выражение не разобрано\n");
+        return 1;
+    }
+    const bool evaluated = calculate();
+
+    struct Phase
+    {
+        const char *name;
+        std::function<bool()> run;
+        double seconds = 0; // лучший из повторов, на один проход
+        double allocations = 0;
+    };
+    Phase phases[] = {{"read", read},
+                      {"convert", convert},
+                      {"evaluate", calculate},
+                      {"total", total}};
+    for (Phase &phase : phases) {
+        phase.seconds = HUGE_VAL;
+        for (size_t repeat = 0; repeat < repeats; ++repeat) {
+            allocationCount = 0;
+            countAllocations = true;
+            auto started = std::chrono::steady_clock::now();
+            for (size_t round = 0; round < rounds; ++round)
+                phase.run();
+            double seconds = secondsSince(started) / rounds;
+            countAllocations = false;
+            phase.seconds = std::min(phase.seconds, seconds);
+            phase.allocations = static_cast<double>(allocationCount) / rounds;
+        }
+    }
+    const size_t peak = peakResidentKilobytes();
+
+    if (json) {
+        std::printf("{\"benchmark\":\"pipeline\",\"shape\":{\"terms\":%zu,\"operands\":%zu,"
+                    "\"depth\":%zu,\"brackets\":\"%s\",\"name_length\":%zu,\"constants\":%g,"
+                    "\"seed\":%llu},\"bytes\":%zu,\"tokens\":%zu,\"instructions\":%zu,"
+                    "\"evaluated\":%s,\"rounds\":%zu,\"repeat\":%zu,\"phases\":{",
+                    shape.terms,
+                    shape.operands,
+                    shape.depth,
+                    shape.brackets.c_str(),
+                    shape.nameLength,
+                    shape.constants,
+                    static_cast<unsigned long long>(shape.seed),
+                    file.size(),
+                    tokens,
+                    program.code().size(),
+                    evaluated ? "true" : "false",
+                    rounds,
+                    repeats);
+        for (const Phase &phase : phases) {
+            std::printf("%s\"%s\":{\"ns_per_round\":%.1f,\"ns_per_token\":%.3f,"
+                        "\"allocations_per_round\":%g}",
+                        &phase == phases ? "" : ",",
+                        phase.name,
+                        phase.seconds * 1e9,
+                        phase.seconds * 1e9 / tokens,
+                        phase.allocations);
+        }
+        std::printf("},\"peak_rss_kb\":%zu}\n", peak);
+        return 0;
+    }
+
+    std::printf("Файл: %zu байт, лексем: %zu, команд: %zu, вычислено: %s\n",
+                file.size(),
+                tokens,
+                program.code().size(),
+                evaluated ? "да" : "нет");
+    std::printf("Проходов: %zu, повторов: %zu (лучший)\n", rounds, repeats);
+    // Заголовок без ширины полей: printf считает байты, а не символы кириллицы
+    std::printf("этап            нс/проход   нс/лексема      выделений\n");
+    for (const Phase &phase : phases) {
+        std::printf("%-10s %14.0f %12.2f %14g\n",
+                    phase.name,
+                    phase.seconds * 1e9,
+                    phase.seconds * 1e9 / tokens,
+                    phase.allocations);
+    }
+    std::printf("Пиковый RSS: %zu КБ\n", peak);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0) {
+        printUsage();
+        return argc < 2 ? 2 : 0;
+    }
+    if (std::strcmp(argv[1], "parse") == 0)
+        return benchParse(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "alloc") == 0)
+        return benchAllocations(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "fold") == 0)
+        return benchFold(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "cse") == 0)
+        return benchCse(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "incr") == 0)
+        return benchIncremental(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "native") == 0)
+        return benchNative(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "symbols") == 0)
+        return benchSymbols(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "validate") == 0)
+        return benchValidate(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "precision") == 0)
+        return benchPrecision(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "multi") == 0)
+        return benchMulti(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "load") == 0)
+        return benchLoad(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "gen") == 0)
+        return benchGenerate(argc - 2, argv + 2);
+    if (std::strcmp(argv[1], "pipeline") == 0)
+        return benchPipeline(argc - 2, argv + 2);
+
+    std::fprintf(stderr, "ERROR: Неизвестный замер: %s\n", argv[1]);
+    printUsage();
+    return 2;
+}
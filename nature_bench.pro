@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = nature_bench
+
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(engine.pri)
+
+SOURCES += \
+    nature_bench.cpp
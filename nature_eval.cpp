@@ -0,0 +1,828 @@
+#include "columns.h"
+#include "engine.h"
+#include "evalcache.h"
+#include "incremental.h"
+#include "kernels.h"
+#include "metrics.h"
+#include "native.h"
+#include "server.h"
+#include "stream.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void printUsage()
+{
+    std::fprintf(stderr,
+                 "Использование: nature_eval [опции] <файл|каталог>...\n"
+                 "Вычисляет выражения из файлов .txt/.bin без запуска GUI.\n"
+                 "Файл с несколькими выражениями (строки \"имя: выражение\" и общие\n"
+                 "операнды) разбирается один раз; с -q итог печатается как файл:имя: значение\n\n"
+                 "Опции:\n"
+                 "  -q, --quiet         печатать только итог по каждому файлу\n"
+                 "  -t, --table FILE    вычислить выражение по таблице операндов\n"
+                 "                      (.csv или .col); строки 2+ файла задают\n"
+                 "                      недостающие операнды как константы\n"
+                 "  -s, --stream FILE   потоковое вычисление по записям CSV из FILE\n"
+                 "                      ('-' - стандартный ввод), память не растёт\n"
+                 "      --chunk N       записей в порции для --stream (1 - по одной)\n"
+                 "  -w, --watch         следить за файлом выражения и пересчитывать при\n"
+                 "                      изменении операндов только зависящие от них узлы\n"
+                 "  -o, --output FILE   столбец результата для --table/--stream (CSV)\n"
+                 "      --scalar        не использовать SIMD-ядра\n"
+                 "      --native        для --table/--stream собрать выражение в машинный код\n"
+                 "                      локальным компилятором (NATURE_CXX, иначе c++);\n"
+                 "                      если не удалось - обычное вычисление\n"
+                 "      --cache-programs N  размер кэша скомпилированных выражений\n"
+                 "                      (по умолчанию 256, 0 - выключен)\n"
+                 "      --cache-results N   размер кэша результатов по паре\n"
+                 "                      (выражение, операнды), по умолчанию выключен\n"
+                 "      --precision P   double (по умолчанию), interval - результат double\n"
+                 "                      и гарантированная граница погрешности, compensated -\n"
+                 "                      двойная-двойная точность и граница; без кэша\n"
+                 "      --dump          показать программу после оптимизации\n"
+                 "      --validate      только проверить файлы и вывести все ошибки\n"
+                 "                      в виде файл:строка:столбец: сообщение\n"
+                 "      --metrics FILE  сохранить счётчики и гистограммы задержек этапов:\n"
+                 "                      *.json - JSON, иначе текст Prometheus\n"
+                 "  -c, --compile       сохранить .txt как скомпилированный .bin рядом\n"
+                 "  -j, --threads N     число потоков (по умолчанию - все ядра)\n"
+                 "      --scaling       замер скорости на 1, 2, 4 ... всех ядрах\n"
+                 "      --serve SOCKET  сервер вычислений на сокете Unix ('-' - стандартный\n"
+                 "                      ввод и вывод): запрос - содержимое файла выражения\n"
+                 "                      и строка \".\", ответ - строки OK/ERROR и \".\";\n"
+                 "                      скомпилированные выражения остаются в кэше.\n"
+                 "                      Останавливается по SIGINT/SIGTERM или концу ввода\n"
+                 "  -h, --help          показать эту справку\n");
+}
+
+bool isInputFile(const fs::path &path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return ext == ".txt" || ext == ".bin";
+}
+
+// Каталоги разворачиваются в отсортированный список .txt/.bin файлов
+bool collectInputs(const std::string &argument, std::vector<std::string> &files)
+{
+    std::error_code ec;
+    fs::path path(argument);
+    if (fs::is_directory(path, ec)) {
+        std::vector<std::string> found;
+        for (const auto &entry : fs::directory_iterator(path, ec)) {
+            if (entry.is_regular_file(ec) && isInputFile(entry.path()))
+                found.push_back(entry.path().string());
+        }
+        if (ec) {
+            std::fprintf(stderr, "ERROR: Не удалось прочитать каталог: %s\n", argument.c_str());
+            return false;
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+        return true;
+    }
+    if (!fs::exists(path, ec)) {
+        std::fprintf(stderr, "ERROR: Файл не найден: %s\n", argument.c_str());
+        return false;
+    }
+    files.push_back(argument);
+    return true;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point started)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+// Итог обработки одного файла; вывод копится отдельно и печатается в порядке
+// файлов, поэтому результат не зависит от числа потоков
+struct FileOutcome
+{
+    std::string log;
+    double result = 0;
+    double bound = 0; // граница погрешности при --precision interval/compensated
+    // Имена и итоги выражений файла с несколькими выражениями
+    std::vector<std::pair<std::string, ExpressionResult>> expressions;
+    bool ok = false;
+};
+
+void processFiles(const std::vector<std::string> &files,
+                  ThreadPool &pool,
+                  EvalCache *cache,
+                  Metrics *metrics,
+                  const LogOptions &logOptions,
+                  Precision precision,
+                  bool quiet,
+                  std::vector<FileOutcome> &outcomes)
+{
+    outcomes.assign(files.size(), FileOutcome());
+    // Engine хранит рабочую память, поэтому у каждого исполнителя он свой;
+    // кэш при этом общий
+    std::vector<Engine> engines(pool.threadCount());
+    for (Engine &engine : engines) {
+        engine.setCache(cache);
+        engine.setMetrics(metrics);
+        engine.setLogOptions(logOptions);
+        engine.setPrecision(precision);
+    }
+    auto process = [&](size_t index, size_t worker) {
+        FileOutcome &outcome = outcomes[index];
+        Engine &engine = engines[worker];
+        if (!quiet) {
+            engine.setSink([&outcome](MessageKind, const std::string &text) {
+                outcome.log += text;
+                outcome.log += '\n';
+            });
+        }
+        outcome.ok = engine.processFile(files[index], &outcome.result);
+        outcome.bound = engine.errorBound();
+        const ExpressionSet &set = engine.expressions();
+        for (size_t i = 0; i < set.size(); ++i)
+            outcome.expressions.emplace_back(set.name(i), set.result(i));
+    };
+    // Один файл обрабатывается в вызывающем потоке, а пул достаётся его выражениям
+    if (files.size() == 1) {
+        engines[0].setPool(&pool);
+        process(0, 0);
+        return;
+    }
+    pool.run(files.size(), process);
+}
+
+void printQuiet(const std::string &file, const FileOutcome &outcome, Precision precision)
+{
+    auto print = [precision](const std::string &label, bool ok, double value, double bound) {
+        if (ok && precision != Precision::Double)
+            std::printf("%s: %s\n", label.c_str(), Engine::formatPrecise(value, bound).c_str());
+        else if (ok)
+            std::printf("%s: %s\n", label.c_str(), Engine::formatDouble(value).c_str());
+        else
+            std::printf("%s: ERROR\n", label.c_str());
+    };
+    if (outcome.expressions.empty()) {
+        print(file, outcome.ok, outcome.result, outcome.bound);
+        return;
+    }
+    for (const auto &[name, result] : outcome.expressions)
+        print(file + ':' + name, result.status == EvalStatus::Ok, result.value, result.bound);
+}
+
+bool saveMetrics(const Metrics &metrics, const std::string &fileName)
+{
+    if (fileName.empty())
+        return true;
+    std::string error;
+    if (!metrics.save(fileName, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Проверка без вычисления: все ошибки каждого файла за один проход,
+// вывод в порядке файлов
+int validateFiles(const std::vector<std::string> &files,
+                  ThreadPool &pool,
+                  const std::string &metricsFile,
+                  bool quiet,
+                  bool inputsOk)
+{
+    Metrics metrics;
+    std::vector<std::vector<Diagnostic>> diagnostics(files.size());
+    std::vector<Engine> engines(pool.threadCount());
+    for (Engine &engine : engines)
+        engine.setMetrics(&metrics);
+    auto started = std::chrono::steady_clock::now();
+    pool.run(files.size(), [&](size_t index, size_t worker) {
+        engines[worker].validateFile(files[index], diagnostics[index]);
+    });
+    double seconds = secondsSince(started);
+
+    size_t clean = 0;
+    size_t errors = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (diagnostics[i].empty()) {
+            ++clean;
+            if (!quiet)
+                std::printf("%s: ошибок нет\n", files[i].c_str());
+            continue;
+        }
+        errors += diagnostics[i].size();
+        for (const Diagnostic &diagnostic : diagnostics[i]) {
+            std::printf("%s:%zu:%zu: %s\n",
+                        files[i].c_str(),
+                        diagnostic.line,
+                        diagnostic.column,
+                        diagnostic.message.c_str());
+        }
+    }
+
+    std::fflush(stdout);
+    std::fprintf(stderr,
+                 "Файлов: %zu, без ошибок: %zu, ошибок: %zu, потоков: %zu, время: %.3f с\n",
+                 files.size(),
+                 clean,
+                 errors,
+                 pool.threadCount(),
+                 seconds);
+    bool saved = saveMetrics(metrics, metricsFile);
+    return (clean == files.size() && inputsOk && saved) ? 0 : 1;
+}
+
+// Ошибка сборки не фатальна: вычисление остаётся на интерпретаторе
+void buildNative(const std::string &file, const Program &program, NativeProgram &native)
+{
+    std::string error;
+    auto started = std::chrono::steady_clock::now();
+    if (native.build(program, error)) {
+        std::fprintf(stderr,
+                     "%s: машинный код готов за %.3f с\n",
+                     file.c_str(),
+                     secondsSince(started));
+    } else {
+        std::fprintf(stderr, "%s\n%s: используется интерпретатор\n", error.c_str(), file.c_str());
+    }
+}
+
+// Одно выражение по всем строкам таблицы; для нескольких файлов результат
+// пишется в <файл>.result.csv, если не задан --output
+bool evaluateTable(Engine &engine,
+                   const std::string &file,
+                   const ColumnTable &table,
+                   const std::string &output,
+                   ThreadPool &pool,
+                   bool useScalar,
+                   bool useNative,
+                   bool quiet)
+{
+    Program program;
+    OperandMap scalars;
+    if (!engine.loadFile(file, program, scalars)) {
+        std::printf("%s: ERROR\n", file.c_str());
+        return false;
+    }
+
+    ColumnEvaluator evaluator;
+    if (useScalar)
+        evaluator.setKernels(scalarKernels());
+    NativeProgram native;
+    if (useNative) {
+        buildNative(file, program, native);
+        evaluator.setNative(&native);
+    }
+    std::string error;
+    if (!evaluator.prepare(program, table, scalars, error)) {
+        std::printf("%s: %s\n", file.c_str(), error.c_str());
+        return false;
+    }
+
+    ColumnResult result;
+    auto started = std::chrono::steady_clock::now();
+    evaluator.evaluateAll(result, pool);
+    double seconds = secondsSince(started);
+
+    if (!saveResultCsv(output, result, error)) {
+        std::printf("%s: %s\n", file.c_str(), error.c_str());
+        return false;
+    }
+
+    std::printf("%s: строк %zu, делений на ноль %zu, результат: %s\n",
+                file.c_str(),
+                table.rowCount(),
+                result.failures,
+                output.c_str());
+    if (!quiet) {
+        std::printf("Ядра: %s, потоков: %zu, время: %.3f с, %.1f млн строк/с\n",
+                    native.ready() ? "машинный код"
+                    : useScalar    ? scalarKernels().name
+                                   : bestKernels().name,
+                    pool.threadCount(),
+                    seconds,
+                    seconds > 0 ? table.rowCount() / seconds / 1e6 : 0.0);
+    }
+    return result.failures == 0;
+}
+
+// Замер масштабирования: та же работа на 1, 2, 4 ... maxThreads потоках
+int runScaling(const std::vector<std::string> &files,
+               const std::string &tableFile,
+               size_t maxThreads,
+               bool useScalar)
+{
+    std::vector<size_t> counts;
+    for (size_t n = 1; n < maxThreads; n *= 2)
+        counts.push_back(n);
+    counts.push_back(maxThreads);
+
+    ColumnTable table;
+    std::vector<Program> programs(files.size());
+    std::vector<ColumnEvaluator> evaluators(files.size());
+    if (!tableFile.empty()) {
+        std::string error;
+        if (!table.load(tableFile, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        Engine engine;
+        for (size_t i = 0; i < files.size(); ++i) {
+            OperandMap scalars;
+            if (useScalar)
+                evaluators[i].setKernels(scalarKernels());
+            if (!engine.loadFile(files[i], programs[i], scalars)
+                || !evaluators[i].prepare(programs[i], table, scalars, error)) {
+                std::fprintf(stderr, "ERROR: Файл не подходит для замера: %s\n", files[i].c_str());
+                return 1;
+            }
+        }
+    }
+
+    std::printf("%-8s %12s %14s %10s\n", "потоков", "время, с", "в секунду", "ускорение");
+    double baseline = 0;
+    for (size_t threads : counts) {
+        ThreadPool pool(threads);
+        double units = 0;
+        auto started = std::chrono::steady_clock::now();
+        if (tableFile.empty()) {
+            std::vector<FileOutcome> outcomes;
+            processFiles(files,
+                         pool,
+                         nullptr,
+                         nullptr,
+                         LogOptions(),
+                         Precision::Double,
+                         true,
+                         outcomes);
+            units = static_cast<double>(files.size());
+        } else {
+            ColumnResult result;
+            for (const ColumnEvaluator &evaluator : evaluators)
+                evaluator.evaluateAll(result, pool);
+            units = static_cast<double>(files.size() * table.rowCount());
+        }
+        double seconds = secondsSince(started);
+        if (baseline == 0)
+            baseline = seconds;
+        std::printf("%-8zu %12.4f %14.1f %9.2fx\n",
+                    threads,
+                    seconds,
+                    seconds > 0 ? units / seconds : 0.0,
+                    seconds > 0 ? baseline / seconds : 0.0);
+    }
+    std::printf("Единица работы: %s\n", tableFile.empty() ? "файл" : "строка таблицы");
+    return 0;
+}
+
+// Результат выводится по мере чтения порций: в --output или на стандартный вывод
+int evaluateStream(const std::string &file,
+                   const std::string &input,
+                   const std::string &output,
+                   size_t chunkRows,
+                   ThreadPool &pool,
+                   bool useScalar,
+                   bool useNative)
+{
+    Engine engine;
+    Program program;
+    OperandMap scalars;
+    if (!engine.loadFile(file, program, scalars)) {
+        std::fprintf(stderr, "%s: ERROR\n", file.c_str());
+        return 1;
+    }
+
+    std::ifstream inFile;
+    if (input != "-") {
+        inFile.open(input);
+        if (!inFile.is_open()) {
+            std::fprintf(stderr, "ERROR: Не удалось открыть поток операндов: %s\n", input.c_str());
+            return 1;
+        }
+    }
+    std::ofstream outFile;
+    if (!output.empty()) {
+        outFile.open(output);
+        if (!outFile.is_open()) {
+            std::fprintf(stderr, "ERROR: Не удалось создать файл результата: %s\n", output.c_str());
+            return 1;
+        }
+    }
+
+    StreamEvaluator stream(program, scalars);
+    stream.setChunkRows(chunkRows);
+    stream.setPool(&pool);
+    if (useScalar)
+        stream.setKernels(scalarKernels());
+    NativeProgram native;
+    if (useNative) {
+        buildNative(file, program, native);
+        stream.setNative(&native);
+    }
+
+    std::ios::sync_with_stdio(false);
+    std::string error;
+    auto started = std::chrono::steady_clock::now();
+    bool ok = stream.run(input == "-" ? std::cin : inFile,
+                         output.empty() ? std::cout : outFile,
+                         error);
+    double seconds = secondsSince(started);
+
+    if (!ok)
+        std::fprintf(stderr, "%s\n", error.c_str());
+    std::fprintf(stderr,
+                 "Записей: %zu, делений на ноль: %zu, время: %.3f с, %.1f тыс. записей/с\n",
+                 stream.rowCount(),
+                 stream.failureCount(),
+                 seconds,
+                 seconds > 0 ? stream.rowCount() / seconds / 1e3 : 0.0);
+    return ok && stream.failureCount() == 0 ? 0 : 1;
+}
+
+EvalServer *activeServer = nullptr;
+
+void stopServer(int)
+{
+    if (activeServer)
+        activeServer->stop();
+}
+
+// Сервер работает до сигнала остановки, а на стандартном вводе - до его конца
+int serve(const std::string &socketPath,
+          ThreadPool &pool,
+          EvalCache &cache,
+          Precision precision,
+          const std::string &metricsFile)
+{
+    Metrics metrics;
+    Engine engine;
+    engine.setCache(&cache);
+    engine.setMetrics(&metrics);
+    // Сервер работает в вызывающем потоке, поэтому пул достаётся выражениям запроса
+    engine.setPool(&pool);
+    EvalServer server(engine);
+    server.setPrecision(precision);
+    activeServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+#ifdef SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    std::string error;
+    auto started = std::chrono::steady_clock::now();
+    bool ok = false;
+    if (socketPath == "-") {
+        ok = server.serveStream(0, 1, error);
+    } else {
+        std::fprintf(stderr, "Сервер ожидает запросы на сокете %s\n", socketPath.c_str());
+        ok = server.serveSocket(socketPath, error);
+    }
+    activeServer = nullptr;
+    if (!ok)
+        std::fprintf(stderr, "%s\n", error.c_str());
+
+    CacheStats stats = cache.stats();
+    std::fprintf(stderr,
+                 "Запросов: %zu, с ошибками: %zu, время: %.3f с; кэш программ: попаданий %zu, "
+                 "промахов %zu\n",
+                 server.requestCount(),
+                 server.failureCount(),
+                 secondsSince(started),
+                 stats.programHits,
+                 stats.programMisses);
+    std::fputs(metrics.summary().c_str(), stderr);
+    ok = saveMetrics(metrics, metricsFile) && ok;
+    return ok ? 0 : 1;
+}
+
+// Опрос файла раз в интервал: при неизменном выражении программа берётся из кэша,
+// а пересчитываются только узлы, зависящие от изменившихся операндов
+int watchFile(const std::string &file)
+{
+    constexpr auto PollInterval = std::chrono::milliseconds(200);
+    EvalCache cache;
+    Engine engine;
+    engine.setCache(&cache);
+    Program current;
+    IncrementalEvaluator incremental;
+    bool ready = false;
+    fs::file_time_type lastWrite;
+    std::uintmax_t lastSize = 0;
+    std::vector<double> slots;
+
+    for (bool first = true;; first = false) {
+        std::error_code code;
+        fs::file_time_type write = fs::last_write_time(file, code);
+        std::uintmax_t size = code ? 0 : fs::file_size(file, code);
+        if (!first && (code || (write == lastWrite && size == lastSize))) {
+            std::this_thread::sleep_for(PollInterval);
+            continue;
+        }
+        lastWrite = write;
+        lastSize = size;
+
+        Program program;
+        OperandMap operands;
+        auto started = std::chrono::steady_clock::now();
+        if (!engine.loadFile(file, program, operands)) {
+            std::string_view errors = engine.errors();
+            if (errors.empty())
+                std::printf("%s: ERROR\n", file.c_str());
+            while (!errors.empty()) {
+                const size_t end = errors.find('\n');
+                const std::string_view line = errors.substr(0, end);
+                std::printf("%s: %.*s\n", file.c_str(), static_cast<int>(line.size()), line.data());
+                errors.remove_prefix(end == std::string_view::npos ? errors.size() : end + 1);
+            }
+            ready = false;
+        } else {
+            bool rebuild = !ready || !program.sameCode(current);
+            slots.assign(program.variableCount(), 0);
+            size_t missing = program.bind(operands, slots.data());
+            double value = 0;
+            EvalStatus status = EvalStatus::Malformed;
+            if (missing != 0) {
+                // Пересчёта не было; следующая правка строит граф заново
+                ready = false;
+            } else if (rebuild) {
+                current = std::move(program);
+                ready = incremental.reset(current, slots.data());
+                status = ready ? incremental.update(value) : EvalStatus::Malformed;
+            } else {
+                for (size_t slot = 0; slot < slots.size(); ++slot)
+                    incremental.setOperand(slot, slots[slot]);
+                status = incremental.update(value);
+            }
+
+            if (missing != 0)
+                std::printf("%s: ERROR: Неопределённых операндов: %zu\n", file.c_str(), missing);
+            else if (status == EvalStatus::DivisionByZero)
+                std::printf("%s: ERROR: деление на ноль\n", file.c_str());
+            else if (status != EvalStatus::Ok)
+                std::printf("%s: ERROR\n", file.c_str());
+            else
+                std::printf("%s: %s\n", file.c_str(), Engine::formatDouble(value).c_str());
+            if (ready) {
+                std::printf("  %s: пересчитано узлов %zu из %zu, %.3f мс\n",
+                            rebuild ? "полный пересчёт" : "изменились операнды",
+                            rebuild ? incremental.nodeCount() : incremental.recomputedCount(),
+                            incremental.nodeCount(),
+                            secondsSince(started) * 1e3);
+            }
+        }
+        std::fflush(stdout);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    bool quiet = false;
+    bool useScalar = false;
+    bool useNative = false;
+    bool scaling = false;
+    bool compile = false;
+    bool watch = false;
+    bool validateOnly = false;
+    Precision precision = Precision::Double;
+    size_t threads = 0;
+    size_t chunkRows = StreamEvaluator::DefaultChunkRows;
+    size_t programCacheSize = 256;
+    size_t resultCacheSize = 0;
+    LogOptions logOptions;
+    std::string streamInput;
+    std::string tableFile;
+    std::string outputFile;
+    std::string metricsFile;
+    std::string serveSocket;
+    std::vector<std::string> files;
+    bool inputsOk = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-q") == 0 || std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (std::strcmp(argv[i], "--scalar") == 0) {
+            useScalar = true;
+        } else if (std::strcmp(argv[i], "--native") == 0) {
+            useNative = true;
+        } else if (std::strcmp(argv[i], "-c") == 0 || std::strcmp(argv[i], "--compile") == 0) {
+            compile = true;
+        } else if (std::strcmp(argv[i], "-w") == 0 || std::strcmp(argv[i], "--watch") == 0) {
+            watch = true;
+        } else if (std::strcmp(argv[i], "--dump") == 0) {
+            logOptions.program = true;
+        } else if (std::strcmp(argv[i], "--validate") == 0) {
+            validateOnly = true;
+        } else if (std::strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if ((std::strcmp(argv[i], "-j") == 0 || std::strcmp(argv[i], "--threads") == 0)
+                   && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if ((std::strcmp(argv[i], "-t") == 0 || std::strcmp(argv[i], "--table") == 0)
+                   && i + 1 < argc) {
+            tableFile = argv[++i];
+        } else if ((std::strcmp(argv[i], "-s") == 0 || std::strcmp(argv[i], "--stream") == 0)
+                   && i + 1 < argc) {
+            streamInput = argv[++i];
+        } else if (std::strcmp(argv[i], "--cache-programs") == 0 && i + 1 < argc) {
+            programCacheSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--cache-results") == 0 && i + 1 < argc) {
+            resultCacheSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serveSocket = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (std::strcmp(mode, "double") == 0) {
+                precision = Precision::Double;
+            } else if (std::strcmp(mode, "interval") == 0) {
+                precision = Precision::Interval;
+            } else if (std::strcmp(mode, "compensated") == 0) {
+                precision = Precision::Compensated;
+            } else {
+                std::fprintf(stderr, "ERROR: Неизвестная точность: %s\n", mode);
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunkRows = std::strtoul(argv[++i], nullptr, 10);
+        } else if ((std::strcmp(argv[i], "-o") == 0 || std::strcmp(argv[i], "--output") == 0)
+                   && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            printUsage();
+            return 0;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            std::fprintf(stderr, "ERROR: Неизвестная опция: %s\n", argv[i]);
+            printUsage();
+            return 2;
+        } else {
+            inputsOk = collectInputs(argv[i], files) && inputsOk;
+        }
+    }
+
+    if (!serveSocket.empty()) {
+        if (!files.empty()) {
+            std::fprintf(stderr, "ERROR: --serve получает выражения в запросах, а не в файлах\n");
+            return 2;
+        }
+        ThreadPool pool(threads == 0 ? ThreadPool::hardwareThreads() : threads);
+        EvalCache cache(programCacheSize, resultCacheSize);
+        return serve(serveSocket, pool, cache, precision, metricsFile);
+    }
+
+    if (files.empty()) {
+        if (inputsOk)
+            printUsage();
+        return 2;
+    }
+    if (threads == 0)
+        threads = ThreadPool::hardwareThreads();
+
+    if (compile) {
+        Engine engine([](MessageKind, const std::string &text) {
+            std::printf("%s\n", text.c_str());
+        });
+        bool allOk = inputsOk;
+        for (const std::string &file : files) {
+            fs::path target(file);
+            if (target.extension() == ".bin")
+                continue;
+            target.replace_extension(".bin");
+            allOk = engine.convertToBinaryAndSave(file, target.string()) && allOk;
+        }
+        return allOk ? 0 : 1;
+    }
+
+    if (scaling)
+        return runScaling(files, tableFile, threads, useScalar);
+
+    ThreadPool pool(threads);
+
+    if (validateOnly)
+        return validateFiles(files, pool, metricsFile, quiet, inputsOk);
+
+    if (precision != Precision::Double && (watch || !streamInput.empty() || !tableFile.empty())) {
+        std::fprintf(stderr, "ERROR: --precision применяется только к вычислению файлов\n");
+        return 2;
+    }
+
+    if (watch) {
+        if (files.size() != 1) {
+            std::fprintf(stderr, "ERROR: --watch принимает ровно один файл выражения\n");
+            return 2;
+        }
+        return watchFile(files[0]);
+    }
+
+    if (!streamInput.empty()) {
+        if (files.size() != 1) {
+            std::fprintf(stderr, "ERROR: --stream принимает ровно один файл выражения\n");
+            return 2;
+        }
+        return evaluateStream(files[0],
+                              streamInput,
+                              outputFile,
+                              chunkRows,
+                              pool,
+                              useScalar,
+                              useNative);
+    }
+
+    if (!tableFile.empty()) {
+        ColumnTable table;
+        std::string error;
+        if (!table.load(tableFile, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (!outputFile.empty() && files.size() > 1) {
+            std::fprintf(stderr, "ERROR: --output допустим только для одного файла выражения\n");
+            return 2;
+        }
+
+        Metrics metrics;
+        Engine engine;
+        engine.setMetrics(&metrics);
+        engine.setLogOptions(logOptions);
+        if (!quiet) {
+            engine.setSink([](MessageKind, const std::string &text) {
+                std::fwrite(text.data(), 1, text.size(), stdout);
+                std::fputc('\n', stdout);
+            });
+        }
+
+        bool allOk = inputsOk;
+        for (const std::string &file : files) {
+            std::string output = outputFile.empty() ? file + ".result.csv" : outputFile;
+            allOk = evaluateTable(engine, file, table, output, pool, useScalar, useNative, quiet)
+                    && allOk;
+        }
+        allOk = saveMetrics(metrics, metricsFile) && allOk;
+        return allOk ? 0 : 1;
+    }
+
+    EvalCache cache(programCacheSize, resultCacheSize);
+    Metrics metrics;
+    auto started = std::chrono::steady_clock::now();
+    std::vector<FileOutcome> outcomes;
+    processFiles(files, pool, &cache, &metrics, logOptions, precision, quiet, outcomes);
+    double seconds = secondsSince(started);
+
+    size_t failed = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const FileOutcome &outcome = outcomes[i];
+        if (!outcome.ok)
+            ++failed;
+        if (quiet) {
+            printQuiet(files[i], outcome, precision);
+        } else {
+            std::printf("Обработка файла: %s\n", files[i].c_str());
+            std::fwrite(outcome.log.data(), 1, outcome.log.size(), stdout);
+            std::printf("\n");
+        }
+    }
+
+    std::fflush(stdout);
+    std::fprintf(stderr,
+                 "Файлов: %zu, успешно: %zu, с ошибками: %zu, потоков: %zu, время: %.3f с, "
+                 "%.1f файлов/с\n",
+                 files.size(),
+                 files.size() - failed,
+                 failed,
+                 pool.threadCount(),
+                 seconds,
+                 seconds > 0 ? files.size() / seconds : 0.0);
+
+    CacheStats stats = cache.stats();
+    std::fprintf(stderr,
+                 "Кэш программ: попаданий %zu, промахов %zu; кэш результатов: попаданий %zu, "
+                 "промахов %zu; вытеснено %zu\n",
+                 stats.programHits,
+                 stats.programMisses,
+                 stats.resultHits,
+                 stats.resultMisses,
+                 stats.evictions);
+
+    bool saved = saveMetrics(metrics, metricsFile);
+    return (failed == 0 && inputsOk && saved) ? 0 : 1;
+}
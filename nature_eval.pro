@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = nature_eval
+
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+include(engine.pri)
+
+SOURCES += \
+    nature_eval.cpp
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
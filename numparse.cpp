@@ -0,0 +1,95 @@
+#include "numparse.h"
+#include <charconv>
+#include <string>
+#include <system_error>
+
+namespace {
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+} // namespace
+
+bool parseNumber(std::string_view text, double &value)
+{
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && isBlank(text[begin]))
+        ++begin;
+    while (end > begin && isBlank(text[end - 1]))
+        --end;
+
+    const char *first = text.data() + begin;
+    const char *last = text.data() + end;
+    // from_chars не принимает ведущий '+'
+    if (first != last && *first == '+' && last - first > 1 && first[1] != '-')
+        ++first;
+
+    // Проверка формы числа: from_chars сам по себе допускает inf, nan и хвостовой мусор
+    const char *p = first;
+    if (p != last && *p == '-')
+        ++p;
+    size_t digits = 0;
+    while (p != last && isDigit(*p)) {
+        ++p;
+        ++digits;
+    }
+    const char *separator = nullptr;
+    if (p != last && (*p == '.' || *p == ',')) {
+        separator = p++;
+        while (p != last && isDigit(*p)) {
+            ++p;
+            ++digits;
+        }
+    }
+    if (digits == 0)
+        return false;
+    if (p != last && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p != last && (*p == '+' || *p == '-'))
+            ++p;
+        if (p == last || !isDigit(*p))
+            return false;
+        while (p != last && isDigit(*p))
+            ++p;
+    }
+    if (p != last)
+        return false;
+
+    std::from_chars_result res;
+    if (separator && *separator == ',') {
+        // Копия с '.' вместо ','; длинные числа - редкость, для них допустима строка
+        char local[128];
+        const size_t length = static_cast<size_t>(last - first);
+        std::string heap;
+        char *copy = local;
+        if (length > sizeof(local)) {
+            heap.assign(first, length);
+            copy = &heap[0];
+        } else {
+            std::char_traits<char>::copy(local, first, length);
+        }
+        copy[separator - first] = '.';
+        res = std::from_chars(copy, copy + length, value);
+        return res.ec == std::errc() && res.ptr == copy + length;
+    }
+
+    res = std::from_chars(first, last, value);
+    return res.ec == std::errc() && res.ptr == last;
+}
+
+bool isAllDigits(std::string_view text)
+{
+    for (char c : text) {
+        if (!isDigit(c))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,14 @@
+#ifndef NUMPARSE_H
+#define NUMPARSE_H
+
+#include <string_view>
+
+// Разбор десятичного числа без выделения памяти и исключений.
+// Допустимо: [+|-]цифры[(.|,)цифры][(e|E)[+|-]цифры], пробелы и табуляции по краям;
+// ',' и '.' равноправны как десятичный разделитель. Всё прочее - ошибка (false)
+bool parseNumber(std::string_view text, double &value);
+
+// Токен из одних цифр (имя операнда не может быть числом)
+bool isAllDigits(std::string_view text);
+
+#endif // NUMPARSE_H
@@ -0,0 +1,125 @@
+#include "operators.h"
+#include <iterator>
+
+namespace {
+
+// Новая операция - новая строка таблицы, код OpCode и ветка applyUnary/applyBinary.
+// Сравнения связывают слабее всего: a + b < c - (a + b) < c; ^ правоассоциативен
+constexpr Operator Operators[] = {
+    {"+", OpCode::Add, 2, 2, false, "%a + %b"},
+    {"-", OpCode::Subtract, 2, 2, false, "%a - %b"},
+    {"*", OpCode::Multiply, 2, 3, false, "%a * %b"},
+    {"/", OpCode::Divide, 2, 3, false, "%a / %b"},
+    {"^", OpCode::Power, 2, 4, true, "std::pow(%a, %b)"},
+    {"<", OpCode::Less, 2, 1, false, "%a < %b ? 1.0 : 0.0"},
+    {"<=", OpCode::LessEqual, 2, 1, false, "%a <= %b ? 1.0 : 0.0"},
+    {">", OpCode::Greater, 2, 1, false, "%a > %b ? 1.0 : 0.0"},
+    {">=", OpCode::GreaterEqual, 2, 1, false, "%a >= %b ? 1.0 : 0.0"},
+    {"==", OpCode::Equal, 2, 1, false, "%a == %b ? 1.0 : 0.0"},
+    {"!=", OpCode::NotEqual, 2, 1, false, "%a != %b ? 1.0 : 0.0"},
+    {"min", OpCode::Min, 2, 0, false, "%b < %a ? %b : %a"},
+    {"max", OpCode::Max, 2, 0, false, "%a < %b ? %b : %a"},
+    {"sqrt", OpCode::Sqrt, 1, 0, false, "std::sqrt(%a)"},
+    {"abs", OpCode::Abs, 1, 0, false, "std::fabs(%a)"},
+    {"exp", OpCode::Exp, 1, 0, false, "std::exp(%a)"},
+    {"log", OpCode::Log, 1, 0, false, "std::log(%a)"},
+};
+
+constexpr size_t OpCodeCount = static_cast<size_t>(OpCode::Log) + 1;
+
+// Описание по коду операции: индекс в Operators + 1, 0 - не операция таблицы
+struct OpCodeIndex
+{
+    std::uint8_t entry[OpCodeCount] = {};
+
+    constexpr OpCodeIndex()
+    {
+        for (size_t i = 0; i < std::size(Operators); ++i)
+            entry[static_cast<size_t>(Operators[i].op)] = static_cast<std::uint8_t>(i + 1);
+    }
+};
+
+constexpr OpCodeIndex Index;
+
+static_assert(std::size(Operators) <= 32, "строки таблицы хранятся в 32 битах FirstChars");
+
+// Записи по первому символу: разбор выражения спрашивает о каждом символе, а операции
+// начинаются лишь с немногих из них. Бит i - строка i таблицы Operators
+struct FirstChars
+{
+    std::uint32_t infix[256] = {};
+    std::uint32_t any[256] = {};
+
+    constexpr FirstChars()
+    {
+        for (size_t i = 0; i < std::size(Operators); ++i) {
+            const auto first = static_cast<unsigned char>(Operators[i].name[0]);
+            any[first] |= std::uint32_t(1) << i;
+            if (Operators[i].precedence != 0)
+                infix[first] |= std::uint32_t(1) << i;
+        }
+    }
+};
+
+constexpr FirstChars First;
+
+} // namespace
+
+const Operator *findOperator(std::string_view name)
+{
+    std::uint32_t candidates = name.empty() ? 0 : First.any[static_cast<unsigned char>(name[0])];
+    for (size_t i = 0; candidates != 0; ++i, candidates >>= 1) {
+        if ((candidates & 1) && name == Operators[i].name)
+            return &Operators[i];
+    }
+    return nullptr;
+}
+
+const Operator *matchInfix(std::string_view text)
+{
+    const Operator *best = nullptr;
+    size_t bestLength = 0;
+    std::uint32_t candidates = text.empty() ? 0 : First.infix[static_cast<unsigned char>(text[0])];
+    for (size_t i = 0; candidates != 0; ++i, candidates >>= 1) {
+        if (!(candidates & 1))
+            continue;
+        const char *name = Operators[i].name;
+        size_t length = 0;
+        while (name[length] != '\0' && length < text.size() && text[length] == name[length])
+            ++length;
+        if (name[length] == '\0' && length > bestLength) {
+            best = &Operators[i];
+            bestLength = length;
+        }
+    }
+    return best;
+}
+
+bool startsInfix(char c)
+{
+    return First.infix[static_cast<unsigned char>(c)] != 0;
+}
+
+const Operator *operatorFor(OpCode op)
+{
+    const size_t code = static_cast<size_t>(op);
+    if (code >= OpCodeCount || Index.entry[code] == 0)
+        return nullptr;
+    return &Operators[Index.entry[code] - 1];
+}
+
+int arity(OpCode op)
+{
+    if (op == OpCode::Negate)
+        return 1;
+    const Operator *entry = operatorFor(op);
+    return entry ? entry->arity : 0;
+}
+
+const char *operatorName(OpCode op)
+{
+    if (op == OpCode::Negate)
+        return "-";
+    const Operator *entry = operatorFor(op);
+    return entry ? entry->name : "?";
+}
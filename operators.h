@@ -0,0 +1,88 @@
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+#include "program.h"
+#include <cmath>
+#include <string_view>
+
+// Операция выражения. Одна таблица описывает запись операции для convertToRPN,
+// токен ОПЗ для Program::compile, её вычисление и код для native.cpp
+struct Operator
+{
+    const char *name; // запись в выражении и в ОПЗ
+    OpCode op;
+    int arity;
+    // Приоритет инфиксного оператора (больше - связывает сильнее);
+    // 0 - функция: name(аргументы через ';')
+    int precedence;
+    bool rightAssociative;
+    // Выражение C++ для native.cpp: %a и %b заменяются операндами
+    const char *cxx;
+};
+
+// Оператор или функция по записи; nullptr - не операция
+const Operator *findOperator(std::string_view name);
+// Самый длинный инфиксный оператор в начале text ("<=", а не "<"); nullptr - нет
+const Operator *matchInfix(std::string_view text);
+// Может ли с символа начинаться инфиксный оператор (для '!' - да, "!=")
+bool startsInfix(char c);
+// Описание кода операции; nullptr для Constant, Variable, BadNumber, Store, Load и Negate
+const Operator *operatorFor(OpCode op);
+// Сколько значений команда снимает со стека (Store только читает вершину)
+int arity(OpCode op);
+// Запись операции для журнала; Negate - "-"
+const char *operatorName(OpCode op);
+
+// Вычисление операций таблицы. Вне области определения - результат <cmath> (NaN, inf);
+// ошибкой остаётся только деление на ноль, его проверяют вызывающие.
+// Сравнения дают 1 или 0; min и max устроены как b < a ? b : a, чтобы результат
+// для -0 и NaN не зависел от реализации std::fmin и совпадал с кодом native.cpp
+inline double applyUnary(OpCode op, double a)
+{
+    switch (op) {
+    case OpCode::Negate:
+        return 0.0 - a;
+    case OpCode::Sqrt:
+        return std::sqrt(a);
+    case OpCode::Abs:
+        return std::fabs(a);
+    case OpCode::Exp:
+        return std::exp(a);
+    default:
+        return std::log(a);
+    }
+}
+
+inline double applyBinary(OpCode op, double a, double b)
+{
+    switch (op) {
+    case OpCode::Add:
+        return a + b;
+    case OpCode::Subtract:
+        return a - b;
+    case OpCode::Multiply:
+        return a * b;
+    case OpCode::Divide:
+        return a / b;
+    case OpCode::Power:
+        return std::pow(a, b);
+    case OpCode::Less:
+        return a < b ? 1.0 : 0.0;
+    case OpCode::LessEqual:
+        return a <= b ? 1.0 : 0.0;
+    case OpCode::Greater:
+        return a > b ? 1.0 : 0.0;
+    case OpCode::GreaterEqual:
+        return a >= b ? 1.0 : 0.0;
+    case OpCode::Equal:
+        return a == b ? 1.0 : 0.0;
+    case OpCode::NotEqual:
+        return a != b ? 1.0 : 0.0;
+    case OpCode::Min:
+        return b < a ? b : a;
+    default:
+        return a < b ? b : a;
+    }
+}
+
+#endif // OPERATORS_H
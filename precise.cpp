@@ -0,0 +1,751 @@
+#include "precise.h"
+#include "operators.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+using DoubleDouble = PreciseEvaluator::DoubleDouble;
+using Ball = PreciseEvaluator::Ball;
+using Interval = PreciseEvaluator::Interval;
+
+constexpr double Infinity = std::numeric_limits<double>::infinity();
+constexpr double Largest = std::numeric_limits<double>::max();
+// Относительные погрешности: u = 2^-53 для double, u^2 - масштаб двойной-двойной
+constexpr double UnitSquared = 0x1p-106;
+// Ниже этого модуля младшие части и ошибки округления могут уйти в денормалы,
+// и относительные оценки перестают действовать; тогда добавляется Underflow
+constexpr double Tiny = 0x1p-900;
+constexpr double Underflow = 8 * std::numeric_limits<double>::denorm_min();
+
+bool tiny(double x)
+{
+    return x != 0 && std::fabs(x) < Tiny;
+}
+
+// Соседние double (std::nextafter без вызова библиотеки): шаг по битам
+double step(double x, bool up)
+{
+    if (std::isnan(x) || x == (up ? Infinity : -Infinity))
+        return x;
+    if (x == 0)
+        return up ? std::numeric_limits<double>::denorm_min()
+                  : -std::numeric_limits<double>::denorm_min();
+    std::uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = (x > 0) == up ? bits + 1 : bits - 1;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+double next(double x)
+{
+    return step(x, true);
+}
+
+double previous(double x)
+{
+    return step(x, false);
+}
+
+// Граница по округлённому результату и знаку его ошибки error (точное = r + error).
+// Переполнение конечных операндов даёт inf, а точное значение конечно
+double lower(double r, double error, bool finiteOperands)
+{
+    if (std::isinf(r))
+        return r > 0 && finiteOperands ? Largest : r;
+    return error < 0 ? previous(r) : r;
+}
+
+double upper(double r, double error, bool finiteOperands)
+{
+    if (std::isinf(r))
+        return r < 0 && finiteOperands ? -Largest : r;
+    return error > 0 ? next(r) : r;
+}
+
+// Ошибки округления основных операций (Dekker, Knuth): точное = результат + ошибка
+double sumError(double a, double b, double s)
+{
+    const double part = s - a;
+    return (a - (s - part)) + (b - part);
+}
+
+double productError(double a, double b, double p)
+{
+    return std::fma(a, b, -p);
+}
+
+// Для частного знак ошибки: a / b - q = -fma(q, b, -a) / b
+double quotientError(double a, double b, double q)
+{
+    const double residual = std::fma(q, b, -a);
+    return b > 0 ? -residual : residual;
+}
+
+double addDown(double a, double b)
+{
+    const double s = a + b;
+    return lower(s, sumError(a, b, s), std::isfinite(a) && std::isfinite(b));
+}
+
+double addUp(double a, double b)
+{
+    const double s = a + b;
+    return upper(s, sumError(a, b, s), std::isfinite(a) && std::isfinite(b));
+}
+
+// Вблизи денормалов ошибка произведения и частного сама округляется:
+// тогда шаг наружу делается без проверки её знака
+bool inexactError(double r, double a, double b)
+{
+    return std::fabs(r) < Tiny && a != 0 && b != 0 && !std::isinf(b);
+}
+
+double mulDown(double a, double b)
+{
+    const double p = a * b;
+    if (inexactError(p, a, b))
+        return previous(p);
+    return lower(p, productError(a, b, p), std::isfinite(a) && std::isfinite(b));
+}
+
+double mulUp(double a, double b)
+{
+    const double p = a * b;
+    if (inexactError(p, a, b))
+        return next(p);
+    return upper(p, productError(a, b, p), std::isfinite(a) && std::isfinite(b));
+}
+
+double divDown(double a, double b)
+{
+    const double q = a / b;
+    if (inexactError(q, a, b))
+        return previous(q);
+    return lower(q, quotientError(a, b, q), std::isfinite(a) && std::isfinite(b));
+}
+
+double divUp(double a, double b)
+{
+    const double q = a / b;
+    if (inexactError(q, a, b))
+        return next(q);
+    return upper(q, quotientError(a, b, q), std::isfinite(a) && std::isfinite(b));
+}
+
+// Интервалы. Entire - граница потеряна
+
+constexpr Interval Entire{-Infinity, Infinity};
+
+Interval point(double value)
+{
+    return {value, value};
+}
+
+// Значения, точные по приложению F стандарта C: exp(0), log(1), log(0), pow(x, 0),
+// pow(1, y), pow(0, y > 0)
+bool exactPower(double a, double b)
+{
+    return b == 0 || a == 1 || (a == 0 && b > 0);
+}
+
+// Библиотечная функция с погрешностью до 1 ulp; inf может быть переполнением
+Interval libraryBounds(double r, bool exact = false)
+{
+    if (exact)
+        return point(r);
+    if (std::isinf(r))
+        return r > 0 ? Interval{Largest, r} : Interval{r, -Largest};
+    return {previous(r), next(r)};
+}
+
+Interval intervalPower(Interval a, Interval b)
+{
+    if (a.lo > 0 || (a.lo == 0 && b.lo > 0)) {
+        // a^b монотонна по каждому аргументу: крайние значения - в углах
+        Interval c[4];
+        Interval *corner = c;
+        for (double x : {a.lo, a.hi}) {
+            for (double y : {b.lo, b.hi})
+                *corner++ = libraryBounds(std::pow(x, y), exactPower(x, y));
+        }
+        return {std::max(0.0, std::min({c[0].lo, c[1].lo, c[2].lo, c[3].lo})),
+                std::max({c[0].hi, c[1].hi, c[2].hi, c[3].hi})};
+    }
+    const double n = b.lo;
+    if (b.lo != b.hi || !std::isfinite(n) || n != std::trunc(n))
+        return a.lo == a.hi && b.lo == b.hi
+                   ? libraryBounds(std::pow(a.lo, b.lo), exactPower(a.lo, b.lo))
+                   : Entire;
+    if (n == 0)
+        return point(1);
+    if (std::fmod(n, 2) == 0) {
+        // Чётная степень зависит от |a|
+        const double far = std::max(std::fabs(a.lo), std::fabs(a.hi));
+        const double near = a.lo <= 0 && a.hi >= 0 ? 0
+                                                   : std::min(std::fabs(a.lo), std::fabs(a.hi));
+        const Interval small = libraryBounds(std::pow(near, n), exactPower(near, n));
+        const Interval large = libraryBounds(std::pow(far, n));
+        return n > 0 ? Interval{std::max(0.0, small.lo), large.hi}
+                     : Interval{std::max(0.0, large.lo), small.hi};
+    }
+    if (n < 0 && a.lo <= 0 && a.hi >= 0)
+        return Entire;
+    const Interval first = libraryBounds(std::pow(n > 0 ? a.lo : a.hi, n));
+    const Interval last = libraryBounds(std::pow(n > 0 ? a.hi : a.lo, n));
+    return {first.lo, last.hi};
+}
+
+Interval intervalUnary(OpCode op, Interval a)
+{
+    switch (op) {
+    case OpCode::Negate:
+        return {0.0 - a.hi, 0.0 - a.lo};
+    case OpCode::Abs:
+        if (a.lo >= 0)
+            return a;
+        if (a.hi <= 0)
+            return {0.0 - a.hi, 0.0 - a.lo};
+        return {0, std::max(0.0 - a.lo, a.hi)};
+    case OpCode::Sqrt: {
+        if (a.lo < 0)
+            return a.hi < 0 ? point(std::sqrt(a.hi)) : Entire;
+        const double low = std::sqrt(a.lo);
+        const double high = std::sqrt(a.hi);
+        // sqrt(x) - s имеет знак, обратный fma(s, s, -x)
+        return {tiny(a.lo) ? previous(low) : lower(low, -productError(low, low, a.lo), true),
+                tiny(a.hi) ? next(high) : upper(high, -productError(high, high, a.hi), true)};
+    }
+    case OpCode::Exp:
+        return {std::max(0.0, libraryBounds(std::exp(a.lo), a.lo == 0 || std::isinf(a.lo)).lo),
+                libraryBounds(std::exp(a.hi), a.hi == 0 || std::isinf(a.hi)).hi};
+    default: // Log
+        if (a.lo < 0)
+            return a.hi < 0 ? point(std::log(a.hi)) : Entire;
+        return {libraryBounds(std::log(a.lo), a.lo == 0 || a.lo == 1 || std::isinf(a.lo)).lo,
+                libraryBounds(std::log(a.hi), a.hi == 0 || a.hi == 1 || std::isinf(a.hi)).hi};
+    }
+}
+
+Interval intervalBinary(OpCode op, Interval a, Interval b)
+{
+    const Interval unknown{0, 1}; // сравнение, которое интервалы не решают
+    switch (op) {
+    case OpCode::Add:
+        return {addDown(a.lo, b.lo), addUp(a.hi, b.hi)};
+    case OpCode::Subtract:
+        return {addDown(a.lo, 0.0 - b.hi), addUp(a.hi, 0.0 - b.lo)};
+    case OpCode::Multiply:
+    case OpCode::Divide: {
+        if (op == OpCode::Divide && b.lo <= 0 && b.hi >= 0)
+            return Entire;
+        if (op == OpCode::Multiply && b.lo <= 0 && b.hi >= 0 && (a.lo > 0 || a.hi < 0))
+            std::swap(a, b);
+        if (b.lo > 0 || b.hi < 0) {
+            // Знак b известен: a*b и a/b монотонны по a, второй конец выбирается по знаку
+            const bool negative = b.hi < 0;
+            if (negative)
+                b = {0.0 - b.hi, 0.0 - b.lo};
+            const Interval r = op == OpCode::Multiply
+                                   ? Interval{mulDown(a.lo, a.lo >= 0 ? b.lo : b.hi),
+                                              mulUp(a.hi, a.hi >= 0 ? b.hi : b.lo)}
+                                   : Interval{divDown(a.lo, a.lo >= 0 ? b.hi : b.lo),
+                                              divUp(a.hi, a.hi >= 0 ? b.lo : b.hi)};
+            return negative ? Interval{0.0 - r.hi, 0.0 - r.lo} : r;
+        }
+        // Оба сомножителя задевают ноль: крайние значения - среди произведений концов
+        double low = Infinity;
+        double high = -Infinity;
+        for (double x : {a.lo, a.hi}) {
+            for (double y : {b.lo, b.hi}) {
+                const double down = mulDown(x, y);
+                const double up = mulUp(x, y);
+                if (std::isnan(down) || std::isnan(up))
+                    return Entire;
+                low = std::min(low, down);
+                high = std::max(high, up);
+            }
+        }
+        return {low, high};
+    }
+    case OpCode::Power:
+        return intervalPower(a, b);
+    case OpCode::Less:
+        return a.hi < b.lo ? point(1) : a.lo >= b.hi ? point(0) : unknown;
+    case OpCode::LessEqual:
+        return a.hi <= b.lo ? point(1) : a.lo > b.hi ? point(0) : unknown;
+    case OpCode::Greater:
+        return a.lo > b.hi ? point(1) : a.hi <= b.lo ? point(0) : unknown;
+    case OpCode::GreaterEqual:
+        return a.lo >= b.hi ? point(1) : a.hi < b.lo ? point(0) : unknown;
+    case OpCode::Equal:
+    case OpCode::NotEqual: {
+        const bool equal = a.lo == a.hi && b.lo == b.hi && a.lo == b.lo;
+        const bool apart = a.hi < b.lo || b.hi < a.lo;
+        if (!equal && !apart)
+            return unknown;
+        return point(equal == (op == OpCode::Equal) ? 1 : 0);
+    }
+    case OpCode::Min:
+        return {std::min(a.lo, b.lo), std::min(a.hi, b.hi)};
+    default: // Max
+        return {std::max(a.lo, b.lo), std::max(a.hi, b.hi)};
+    }
+}
+
+// NaN на границе (inf - inf, 0 * inf) - граница потеряна
+Interval checked(Interval r)
+{
+    return std::isnan(r.lo) || std::isnan(r.hi) ? Entire : r;
+}
+
+// Двойная-двойная арифметика. Алгоритмы и их погрешности - Joldes, Muller, Popescu,
+// "Tight and rigorous error bounds for basic building blocks of double-word arithmetic"
+
+DoubleDouble single(double value)
+{
+    return {value, 0};
+}
+
+// Fast2Sum: точная сумма при |a| >= |b|
+DoubleDouble quickSum(double a, double b)
+{
+    const double s = a + b;
+    return {s, b - (s - a)};
+}
+
+// Алгоритм 6 (AccurateDWPlusDW): погрешность до 3u^2
+DoubleDouble ddAdd(DoubleDouble a, DoubleDouble b)
+{
+    const double s = a.hi + b.hi;
+    if (!std::isfinite(s))
+        return single(s);
+    const double t = a.lo + b.lo;
+    const DoubleDouble v = quickSum(s, sumError(a.hi, b.hi, s) + t);
+    return quickSum(v.hi, v.lo + sumError(a.lo, b.lo, t));
+}
+
+DoubleDouble ddNegate(DoubleDouble a)
+{
+    return {0.0 - a.hi, 0.0 - a.lo};
+}
+
+// Алгоритм 12 (DWTimesDW3): погрешность до 5u^2
+DoubleDouble ddMul(DoubleDouble a, DoubleDouble b)
+{
+    const double p = a.hi * b.hi;
+    if (!std::isfinite(p))
+        return single(p);
+    const double low = std::fma(a.lo, b.hi, std::fma(a.hi, b.lo, a.lo * b.lo));
+    return quickSum(p, productError(a.hi, b.hi, p) + low);
+}
+
+// Алгоритм 17 (DWDivDW2): погрешность до 15u^2 + 56u^3
+DoubleDouble ddDiv(DoubleDouble a, DoubleDouble b)
+{
+    const double q = a.hi / b.hi;
+    if (!std::isfinite(q))
+        return single(q);
+    // b * q (DWTimesFP1)
+    const double p = b.hi * q;
+    const DoubleDouble t = quickSum(p, b.lo * q);
+    const DoubleDouble r = quickSum(t.hi, t.lo + productError(b.hi, q, p));
+    const double difference = a.hi - r.hi;
+    const double delta = difference + ((sumError(a.hi, -r.hi, difference) - r.lo) + a.lo);
+    return quickSum(q, delta / b.hi);
+}
+
+// Шаг Ньютона от корня в double; погрешность порядка 2u^2
+DoubleDouble ddSqrt(DoubleDouble a)
+{
+    const double x = std::sqrt(a.hi);
+    if (!(x > 0) || !std::isfinite(x))
+        return single(x);
+    const double square = x * x;
+    const DoubleDouble residual = ddAdd(a, {0.0 - square, 0.0 - productError(x, x, square)});
+    return quickSum(x, residual.hi / (2 * x));
+}
+
+bool ddLess(DoubleDouble a, DoubleDouble b)
+{
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+// Шары: значение в двойной-двойной точности и радиус. Радиус считается в double
+// с округлением вверх; константы погрешностей операций взяты с запасом
+
+// Действия с неотрицательными радиусами: ошибка округления меньше шага к следующему
+// double, поэтому шаг делается без её вычисления. Точный ноль остаётся нулём, 0 * inf = 0
+double sumUp(double a, double b)
+{
+    const double s = a + b;
+    return s == 0 ? s : next(s);
+}
+
+double productUp(double a, double b)
+{
+    return a == 0 || b == 0 ? 0 : next(a * b);
+}
+
+double quotientUp(double a, double b)
+{
+    return a == 0 ? 0 : next(a / b);
+}
+
+// Верхняя граница |a|
+double magnitude(DoubleDouble a)
+{
+    return sumUp(std::fabs(a.hi), std::fabs(a.lo));
+}
+
+// Концы шара с округлением наружу
+double lowest(const Ball &a)
+{
+    return addDown(addDown(a.mid.hi, a.mid.lo), 0.0 - a.radius);
+}
+
+double highest(const Ball &a)
+{
+    return addUp(addUp(a.mid.hi, a.mid.lo), a.radius);
+}
+
+// Нижняя граница |x| для x из шара; <= 0 - шар задевает ноль
+double nearest(const Ball &a)
+{
+    return addDown(addDown(std::fabs(a.mid.hi), 0.0 - std::fabs(a.mid.lo)), 0.0 - a.radius);
+}
+
+// Граница погрешности двойной-двойной операции с результатом r
+// и относительной погрешностью до factor * u^2
+double roundingError(double factor, DoubleDouble r, bool small)
+{
+    const double error = productUp(factor * UnitSquared, magnitude(r));
+    return small || tiny(r.hi) ? sumUp(error, Underflow) : error;
+}
+
+// Библиотечная функция с погрешностью до 1 ulp (не больше |v| * 2^-52)
+double libraryError(double v)
+{
+    const double error = productUp(std::fabs(v), 0x1p-52);
+    return std::fabs(v) < 0x1p-1000 ? sumUp(error, Underflow) : error;
+}
+
+// Переполнение конечных операндов: значение конечно, но граница потеряна
+Ball overflowChecked(Ball r, const Ball &a, const Ball &b)
+{
+    if (std::isinf(r.mid.hi) && std::isfinite(a.mid.hi) && std::isfinite(b.mid.hi))
+        r.radius = Infinity;
+    return r;
+}
+
+Ball ballAdd(const Ball &a, const Ball &b)
+{
+    Ball r{ddAdd(a.mid, b.mid), sumUp(a.radius, b.radius)};
+    // Сумма двух double точна: twoSum без потерь
+    if (a.mid.lo != 0 || b.mid.lo != 0)
+        r.radius = sumUp(r.radius, roundingError(4, r.mid, tiny(a.mid.hi) || tiny(b.mid.hi)));
+    return overflowChecked(r, a, b);
+}
+
+Ball ballNegate(const Ball &a)
+{
+    return {ddNegate(a.mid), a.radius};
+}
+
+Ball ballMul(const Ball &a, const Ball &b)
+{
+    // |xy - ab| <= |a| rb + |b| ra + ra rb
+    const double spread = sumUp(productUp(magnitude(a.mid), b.radius),
+                                productUp(magnitude(b.mid), a.radius));
+    Ball r{ddMul(a.mid, b.mid), sumUp(spread, productUp(a.radius, b.radius))};
+    const bool small = tiny(a.mid.hi) || tiny(b.mid.hi);
+    // Произведение двух double точно, если ошибка fma не ушла в денормалы
+    if (a.mid.lo != 0 || b.mid.lo != 0 || small || tiny(r.mid.hi))
+        r.radius = sumUp(r.radius, roundingError(8, r.mid, small));
+    return overflowChecked(r, a, b);
+}
+
+Ball ballDiv(const Ball &a, const Ball &b)
+{
+    const double divisor = nearest(b);
+    if (a.mid.lo == 0 && b.mid.lo == 0 && a.radius == 0 && b.radius == 0) {
+        // Частное двух double, представимое точно
+        const double q = a.mid.hi / b.mid.hi;
+        if (std::isfinite(q) && !tiny(q) && !tiny(a.mid.hi) && !tiny(b.mid.hi)
+            && quotientError(a.mid.hi, b.mid.hi, q) == 0)
+            return {single(q), 0};
+    }
+    Ball r{ddDiv(a.mid, b.mid), Infinity};
+    if (!(divisor > 0))
+        return r;
+    // |x/y - a/b| <= (ra + |a/b| rb) / (|b| - rb); |a/b| <= magnitude(r) с запасом
+    r.radius = quotientUp(sumUp(a.radius, productUp(magnitude(r.mid), b.radius)), divisor);
+    r.radius = sumUp(r.radius, roundingError(32, r.mid, tiny(a.mid.hi) || tiny(b.mid.hi)));
+    return overflowChecked(r, a, b);
+}
+
+Ball ballSqrt(const Ball &a)
+{
+    const DoubleDouble s = ddSqrt(a.mid);
+    const double low = lowest(a);
+    if (std::isnan(s.hi) && highest(a) < 0)
+        return {s, 0};
+    if (low < 0)
+        return {s, Infinity};
+    if (a.mid.lo == 0 && a.radius == 0 && s.lo == 0 && !tiny(a.mid.hi)
+        && productError(s.hi, s.hi, a.mid.hi) == 0)
+        return {s, 0}; // корень точного квадрата
+    // Шар [0, h]: корни лежат в [0, sqrt(h)]
+    if (low == 0)
+        return {s, next(std::sqrt(highest(a)))};
+    // |sqrt(x) - sqrt(a)| = |x - a| / (sqrt(x) + sqrt(a)) <= ra / sqrt(low)
+    const double spread = a.radius == 0 ? 0 : quotientUp(a.radius, previous(std::sqrt(low)));
+    return {s, sumUp(spread, roundingError(32, s, tiny(a.mid.hi)))};
+}
+
+// Сравнение решено, если разность шаров не задевает ноль
+Ball ballCompare(OpCode op, const Ball &a, const Ball &b)
+{
+    const DoubleDouble d = ddAdd(a.mid, ddNegate(b.mid));
+    double margin = sumUp(a.radius, b.radius);
+    if (a.mid.lo != 0 || b.mid.lo != 0)
+        margin = sumUp(margin, roundingError(4, d, tiny(a.mid.hi) || tiny(b.mid.hi)));
+    const bool decided = !std::isnan(d.hi)
+                         && (margin == 0
+                             || addDown(std::fabs(d.hi), 0.0 - std::fabs(d.lo)) > margin);
+    // Знак разности решает любое сравнение с нулём
+    return {single(applyBinary(op, d.hi, 0.0)), decided ? 0.0 : 1.0};
+}
+
+// Аргумент функций с точностью double: старшая часть, младшая - в радиус
+double argument(const Ball &a, double &radius)
+{
+    radius = a.mid.lo == 0 ? a.radius : sumUp(a.radius, std::fabs(a.mid.lo));
+    return a.mid.hi;
+}
+
+Ball ballExp(const Ball &a)
+{
+    double spread;
+    const double x = argument(a, spread);
+    const double v = std::exp(x);
+    if (std::isnan(v) || (std::isinf(x) && spread == 0))
+        return {single(v), 0};
+    if (std::isinf(v))
+        return {single(v), Infinity};
+    const double error = x == 0 && spread == 0 ? 0 : libraryError(v);
+    if (spread == 0)
+        return {single(v), error};
+    // |exp(y) - exp(x)| <= exp(x) (exp(r) - 1); обе функции - с запасом в 1 ulp
+    return {single(v), sumUp(error, productUp(next(v), next(next(std::expm1(spread)))))};
+}
+
+Ball ballLog(const Ball &a)
+{
+    double spread;
+    const double x = argument(a, spread);
+    const double v = std::log(x);
+    if (spread == 0 && (std::isnan(v) || std::isinf(v)))
+        return {single(v), 0};
+    const double low = spread == 0 ? x : addDown(x, 0.0 - spread);
+    if (!(low > 0))
+        return {single(v), Infinity};
+    const double error = x == 1 ? 0 : libraryError(v);
+    // |log(y) - log(x)| <= r / min(x, y)
+    return {single(v), spread == 0 ? error : sumUp(error, quotientUp(spread, low))};
+}
+
+Ball ballPower(const Ball &a, const Ball &b)
+{
+    const double v = std::pow(a.mid.hi, b.mid.hi);
+    const bool points = a.mid.lo == 0 && b.mid.lo == 0 && a.radius == 0 && b.radius == 0;
+    if (points && (exactPower(a.mid.hi, b.mid.hi) || std::isnan(v)))
+        return {single(v), 0};
+    if (points && std::isfinite(v))
+        return {single(v), libraryError(v)};
+    // a^b = exp(b log a) при a > 0; для целого b - через |a| и знак
+    const double n = b.mid.hi;
+    const bool integer = b.mid.lo == 0 && b.radius == 0 && std::isfinite(n) && n == std::trunc(n);
+    Ball base = a;
+    if (integer && a.mid.hi < 0)
+        base = ballNegate(a);
+    else if (!integer && !(lowest(a) > 0))
+        return {single(v), Infinity};
+    if (!(nearest(base) > 0) || std::isinf(v))
+        return {single(v), Infinity};
+    const Ball e = ballExp(ballMul(b, ballLog(base)));
+    // Значение - от std::pow; радиус шара e дополняется расстоянием до него
+    const double sign = integer && a.mid.hi < 0 && std::fmod(n, 2) != 0 ? -1 : 1;
+    const double composed = sign * e.mid.hi;
+    const double distance = std::max(addUp(v, 0.0 - composed), addUp(composed, 0.0 - v));
+    return {single(v), sumUp(e.radius, distance)};
+}
+
+Ball ballMinMax(OpCode op, const Ball &a, const Ball &b)
+{
+    // min и max не увеличивают расстояние: радиус - больший из двух
+    const bool second = op == OpCode::Min ? ddLess(b.mid, a.mid) : ddLess(a.mid, b.mid);
+    return {second ? b.mid : a.mid, std::max(a.radius, b.radius)};
+}
+
+Ball ballUnary(OpCode op, const Ball &a)
+{
+    switch (op) {
+    case OpCode::Negate:
+        return ballNegate(a);
+    case OpCode::Abs:
+        return a.mid.hi < 0 ? ballNegate(a) : a;
+    case OpCode::Sqrt:
+        return ballSqrt(a);
+    case OpCode::Exp:
+        return ballExp(a);
+    default: // Log
+        return ballLog(a);
+    }
+}
+
+Ball ballBinary(OpCode op, const Ball &a, const Ball &b)
+{
+    switch (op) {
+    case OpCode::Add:
+        return ballAdd(a, b);
+    case OpCode::Subtract:
+        return ballAdd(a, ballNegate(b));
+    case OpCode::Multiply:
+        return ballMul(a, b);
+    case OpCode::Divide:
+        return ballDiv(a, b);
+    case OpCode::Power:
+        return ballPower(a, b);
+    case OpCode::Min:
+    case OpCode::Max:
+        return ballMinMax(op, a, b);
+    default:
+        return ballCompare(op, a, b);
+    }
+}
+
+} // namespace
+
+EvalStatus PreciseEvaluator::evaluate(const Program &program,
+                                      const double *slots,
+                                      Precision precision,
+                                      PreciseResult &result)
+{
+    if (precision == Precision::Compensated)
+        return evaluateCompensated(program, slots, result);
+    return evaluateInterval(program, slots, result);
+}
+
+EvalStatus PreciseEvaluator::evaluateInterval(const Program &program,
+                                              const double *slots,
+                                              PreciseResult &result)
+{
+    const size_t depth = program.stackDepth();
+    values.resize(program.frameSize());
+    ranges.resize(program.frameSize());
+    size_t top = 0;
+
+    for (const Instruction &ins : program.code()) {
+        switch (ins.op) {
+        case OpCode::Constant:
+        case OpCode::Variable:
+            values[top] = ins.op == OpCode::Constant ? program.constant(ins.arg) : slots[ins.arg];
+            ranges[top] = point(values[top]);
+            ++top;
+            break;
+        case OpCode::Store:
+            values[depth + ins.arg] = values[top - 1];
+            ranges[depth + ins.arg] = ranges[top - 1];
+            break;
+        case OpCode::Load:
+            values[top] = values[depth + ins.arg];
+            ranges[top] = ranges[depth + ins.arg];
+            ++top;
+            break;
+        case OpCode::BadNumber:
+            return EvalStatus::BadNumber;
+        default:
+            if (arity(ins.op) == 1) {
+                values[top - 1] = applyUnary(ins.op, values[top - 1]);
+                ranges[top - 1] = checked(intervalUnary(ins.op, ranges[top - 1]));
+                break;
+            }
+            --top;
+            if (ins.op == OpCode::Divide && values[top] == 0)
+                return EvalStatus::DivisionByZero;
+            values[top - 1] = applyBinary(ins.op, values[top - 1], values[top]);
+            ranges[top - 1] = checked(intervalBinary(ins.op, ranges[top - 1], ranges[top]));
+            break;
+        }
+    }
+
+    const Interval range = ranges[0];
+    result.value = values[0];
+    if (std::isnan(result.value)) {
+        result.bound = result.value;
+    } else if (!std::isfinite(range.lo) || !std::isfinite(range.hi)
+               || !std::isfinite(result.value)) {
+        result.bound = range.lo == range.hi && range.lo == result.value ? 0 : Infinity;
+    } else {
+        // Расстояния до концов интервала с округлением вверх
+        result.bound = std::max({addUp(range.hi, 0.0 - result.value),
+                                 addUp(result.value, 0.0 - range.lo),
+                                 0.0});
+    }
+    return EvalStatus::Ok;
+}
+
+EvalStatus PreciseEvaluator::evaluateCompensated(const Program &program,
+                                                 const double *slots,
+                                                 PreciseResult &result)
+{
+    const size_t depth = program.stackDepth();
+    balls.resize(program.frameSize());
+    size_t top = 0;
+
+    for (const Instruction &ins : program.code()) {
+        switch (ins.op) {
+        case OpCode::Constant:
+        case OpCode::Variable: {
+            const double value = ins.op == OpCode::Constant ? program.constant(ins.arg)
+                                                            : slots[ins.arg];
+            balls[top++] = {single(value), 0};
+            break;
+        }
+        case OpCode::Store:
+            balls[depth + ins.arg] = balls[top - 1];
+            break;
+        case OpCode::Load:
+            balls[top++] = balls[depth + ins.arg];
+            break;
+        case OpCode::BadNumber:
+            return EvalStatus::BadNumber;
+        default:
+            if (arity(ins.op) == 1) {
+                balls[top - 1] = ballUnary(ins.op, balls[top - 1]);
+                break;
+            }
+            --top;
+            if (ins.op == OpCode::Divide && balls[top].mid.hi == 0)
+                return EvalStatus::DivisionByZero;
+            balls[top - 1] = ballBinary(ins.op, balls[top - 1], balls[top]);
+            break;
+        }
+    }
+
+    // Значение - hi, округление hi + lo; расстояние до точного hi + lo равно |lo|
+    const Ball &r = balls[0];
+    result.value = r.mid.hi;
+    if (std::isnan(result.value))
+        result.bound = result.value;
+    else if (std::isnan(r.radius) || !std::isfinite(result.value))
+        result.bound = r.radius == 0 ? 0 : Infinity;
+    else
+        result.bound = addUp(r.radius, std::fabs(r.mid.lo));
+    return EvalStatus::Ok;
+}
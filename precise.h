@@ -0,0 +1,78 @@
+#ifndef PRECISE_H
+#define PRECISE_H
+
+#include "program.h"
+#include <vector>
+
+// Точность вычисления выражения
+enum class Precision {
+    Double,     // обычный double, без оценки погрешности
+    Interval,   // результат double и гарантированная граница его погрешности
+    Compensated // двойная-двойная точность (~32 знака), результат округляется до double
+};
+
+// Точное значение выражения над операндами и константами (в том виде, в каком
+// они прочитаны в double) лежит в [value - bound, value + bound].
+// bound = inf - граница потеряна (делитель или аргумент функции может оказаться
+// вне области определения); для value = NaN граница тоже NaN
+struct PreciseResult
+{
+    double value = 0;
+    double bound = 0;
+};
+
+// Вычисление с гарантированной оценкой погрешности.
+// Interval: рядом со значением double считается интервал, заведомо содержащий
+// точный результат. +, -, *, / и sqrt округляются наружу по знаку ошибки
+// округления (twoSum, fma), поэтому точные операции не расширяют интервал.
+// Compensated: значение считается в двойной-двойной арифметике (Bailey, QD) вместе
+// с радиусом - границей его погрешности; погрешность операций берётся по оценкам
+// Joldes, Muller, Popescu (2017) с запасом. ^, exp и log в этом режиме считаются
+// с точностью double, но граница остаётся верной.
+// Библиотечные exp, log и pow считаются точными до 1 ulp, как в glibc.
+// Программа должна быть свёрнута только точно (Program::optimize(true)):
+// иначе граница не учитывает погрешность свёрнутых при компиляции констант
+class PreciseEvaluator
+{
+public:
+    // Только для isWellFormed() и полностью связанных слотов, как Program::evaluate.
+    // Деление на ноль - по значению делителя в выбранной точности
+    EvalStatus evaluate(const Program &program,
+                        const double *slots,
+                        Precision precision,
+                        PreciseResult &result);
+
+    struct DoubleDouble
+    {
+        double hi; // округлённое значение
+        double lo; // остаток: значение = hi + lo точно
+    };
+
+    // Точное значение лежит в [mid - radius, mid + radius]
+    struct Ball
+    {
+        DoubleDouble mid;
+        double radius;
+    };
+
+    struct Interval
+    {
+        double lo;
+        double hi;
+    };
+
+private:
+    EvalStatus evaluateInterval(const Program &program,
+                                const double *slots,
+                                PreciseResult &result);
+    EvalStatus evaluateCompensated(const Program &program,
+                                   const double *slots,
+                                   PreciseResult &result);
+
+    // Стек и временные ячейки, как в Program::evaluate; растут до frameSize()
+    std::vector<double> values;
+    std::vector<Interval> ranges;
+    std::vector<Ball> balls;
+};
+
+#endif // PRECISE_H
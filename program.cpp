@@ -0,0 +1,561 @@
+#include "program.h"
+#include "numparse.h"
+#include "operators.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+// Токен ОПЗ из цифр и разделителей считается числом, остальные - операндами
+bool isNumericToken(std::string_view token)
+{
+    for (char c : token) {
+        if (!(c >= '0' && c <= '9') && c != '.' && c != ',')
+            return false;
+    }
+    return true;
+}
+
+// Сравнение с учётом знака нуля: 0 и -0 для упрощений различаются
+bool isExactly(double value, double expected)
+{
+    return value == expected && std::signbit(value) == std::signbit(expected);
+}
+
+// x op c == x для любого x, включая -0, бесконечности и NaN
+bool isRightIdentity(OpCode op, double c)
+{
+    return ((op == OpCode::Multiply || op == OpCode::Divide) && isExactly(c, 1))
+           || (op == OpCode::Subtract && isExactly(c, 0)) || (op == OpCode::Add && isExactly(c, -0.0));
+}
+
+// c op x == x
+bool isLeftIdentity(OpCode op, double c)
+{
+    return (op == OpCode::Multiply && isExactly(c, 1)) || (op == OpCode::Add && isExactly(c, -0.0));
+}
+
+// Результат операции над константами получен без округления: такую свёртку
+// не заметит и вычисление с оценкой погрешности (precise.h)
+bool foldsExactly(OpCode op, double a, double b, double result)
+{
+    switch (op) {
+    case OpCode::Add:
+    case OpCode::Subtract: {
+        // Ошибка округления суммы по twoSum; для бесконечностей и NaN она не 0
+        const double addend = op == OpCode::Add ? b : -b;
+        const double part = result - a;
+        return (a - (result - part)) + (addend - part) == 0;
+    }
+    // Вблизи денормалов остаток fma сам округляется и может ложно дать 0
+    case OpCode::Multiply:
+        return (result == 0 ? a == 0 || b == 0 : std::fabs(result) >= 0x1p-968)
+               && std::fma(a, b, -result) == 0;
+    case OpCode::Divide:
+        return (result == 0 ? a == 0
+                            : std::fabs(result) >= 0x1p-968 && std::fabs(a) >= 0x1p-968)
+               && std::fma(result, b, -a) == 0;
+    case OpCode::Sqrt:
+        return (a == 0 || a >= 0x1p-968) && std::fma(result, result, -a) == 0;
+    case OpCode::Negate:
+    case OpCode::Abs:
+    case OpCode::Less:
+    case OpCode::LessEqual:
+    case OpCode::Greater:
+    case OpCode::GreaterEqual:
+    case OpCode::Equal:
+    case OpCode::NotEqual:
+    case OpCode::Min:
+    case OpCode::Max:
+        return true;
+    default:
+        return false;
+    }
+}
+
+constexpr std::uint32_t Tombstone = UINT32_MAX;
+
+} // namespace
+
+void Program::clear()
+{
+    instructions.clear();
+    constants.clear();
+    variables.clear();
+    badTokens.clear();
+    maxDepth = 0;
+    temps = 0;
+    wellFormed = false;
+}
+
+void Program::compile(const std::string &rpn)
+{
+    clear();
+
+    // Имён не больше, чем токенов, а токенов не больше половины длины ОПЗ + 1
+    variables.reserve(rpn.size() / 2 + 1);
+    const std::string_view text(rpn);
+    size_t depth = 0;
+    bool underflow = false;
+    size_t begin = 0;
+
+    // Один линейный проход по токенам, разделённым пробелами
+    while (begin < text.size()) {
+        size_t end = text.find(' ', begin);
+        if (end == std::string_view::npos)
+            end = text.size();
+        if (end == begin) {
+            ++begin;
+            continue;
+        }
+        std::string_view token = text.substr(begin, end - begin);
+        begin = end + 1;
+
+        if (const Operator *entry = findOperator(token)) {
+            instructions.push_back({entry->op, 0});
+            if (depth < static_cast<size_t>(entry->arity))
+                underflow = true;
+            else
+                depth -= entry->arity - 1;
+        } else if (isNumericToken(token)) {
+            double value = 0;
+            if (parseNumber(token, value)) {
+                constants.push_back(value);
+                instructions.push_back(
+                    {OpCode::Constant, static_cast<std::uint32_t>(constants.size() - 1)});
+            } else {
+                badTokens.emplace_back(token);
+                instructions.push_back(
+                    {OpCode::BadNumber, static_cast<std::uint32_t>(badTokens.size() - 1)});
+            }
+            ++depth;
+        } else {
+            instructions.push_back({OpCode::Variable, variables.intern(token)});
+            ++depth;
+        }
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    wellFormed = !underflow && badTokens.empty() && depth == 1;
+}
+
+bool Program::assign(std::vector<Instruction> code,
+                     std::vector<double> constantPool,
+                     std::vector<std::string> variableNames)
+{
+    clear();
+
+    size_t depth = 0;
+    std::uint32_t stored = 0;
+    for (const Instruction &ins : code) {
+        switch (ins.op) {
+        case OpCode::Constant:
+            if (ins.arg >= constantPool.size())
+                return false;
+            ++depth;
+            break;
+        case OpCode::Variable:
+            if (ins.arg >= variableNames.size())
+                return false;
+            ++depth;
+            break;
+        // Ячейки нумеруются по порядку первой записи, читать можно только записанные
+        case OpCode::Store:
+            if (depth < 1 || ins.arg != stored)
+                return false;
+            ++stored;
+            break;
+        case OpCode::Load:
+            if (ins.arg >= stored)
+                return false;
+            ++depth;
+            break;
+        case OpCode::BadNumber:
+            return false;
+        default: {
+            const int operands = arity(ins.op);
+            if (operands == 0 || depth < static_cast<size_t>(operands))
+                return false; // неизвестный код операции или нехватка операндов
+            depth -= operands - 1;
+            break;
+        }
+        }
+        maxDepth = std::max(maxDepth, depth);
+    }
+    if (depth != 1) {
+        maxDepth = 0;
+        return false;
+    }
+
+    instructions = std::move(code);
+    constants = std::move(constantPool);
+    temps = stored;
+    variables.reserve(variableNames.size());
+    for (const std::string &name : variableNames) {
+        size_t before = variables.size();
+        variables.intern(name);
+        if (variables.size() == before) {
+            clear();
+            return false; // повторяющееся имя слота
+        }
+    }
+    wellFormed = true;
+    return true;
+}
+
+void Program::optimize(bool exactOnly)
+{
+    // Программа с временными ячейками уже прошла оптимизацию (например, прочитана из .bin)
+    if (!wellFormed || temps != 0)
+        return;
+    foldConstants(exactOnly);
+    eliminateCommonSubexpressions();
+}
+
+void Program::foldConstants(bool exactOnly)
+{
+    // Код переписывается на месте: позиция записи w не обгоняет позицию чтения.
+    // Константа, убранная из середины кода (1*x, 0-x), помечается Tombstone
+    // и выбрасывается последним проходом. Свёрнутое значение пишется в ячейку
+    // левой константы, поэтому ссылки на константы остаются упорядоченными
+    // Программа из assign() может ссылаться на ячейку дважды или не по порядку кода:
+    // без перенумерации свёртка затёрла бы значение, которое ещё прочитают
+    renumberConstants();
+    const size_t before = instructions.size();
+    foldStack.clear();
+    size_t w = 0;
+    bool tombstones = false;
+    auto value = [this](const FoldEntry &entry) -> double & {
+        return constants[instructions[entry.start].arg];
+    };
+
+    for (size_t r = 0; r < before; ++r) {
+        const Instruction ins = instructions[r];
+        if (ins.op == OpCode::Constant || ins.op == OpCode::Variable) {
+            foldStack.push_back({w, ins.op == OpCode::Constant, 0});
+            instructions[w++] = ins;
+            continue;
+        }
+
+        if (arity(ins.op) == 1) {
+            FoldEntry &a = foldStack.back();
+            const double folded = a.constant ? applyUnary(ins.op, value(a)) : 0;
+            if (a.constant && (!exactOnly || foldsExactly(ins.op, value(a), 0, folded))) {
+                value(a) = folded;
+            } else {
+                instructions[w++] = ins;
+                a.constant = false;
+            }
+            continue;
+        }
+
+        const FoldEntry b = foldStack.back();
+        foldStack.pop_back();
+        FoldEntry &a = foldStack.back();
+
+        // Деление на константный ноль остаётся ошибкой времени вычисления
+        const bool foldable = a.constant && b.constant
+                              && !(ins.op == OpCode::Divide && value(b) == 0);
+        const double folded = foldable ? applyBinary(ins.op, value(a), value(b)) : 0;
+        if (foldable && (!exactOnly || foldsExactly(ins.op, value(a), value(b), folded))) {
+            value(a) = folded;
+            w = a.start + 1;
+        } else if (b.constant && isRightIdentity(ins.op, value(b))) {
+            w = b.start;
+        } else if (a.constant && isLeftIdentity(ins.op, value(a))) {
+            instructions[a.start].arg = Tombstone;
+            tombstones = true;
+            a.constant = false;
+        } else if (a.constant && ins.op == OpCode::Subtract && isExactly(value(a), 0)) {
+            instructions[a.start].arg = Tombstone;
+            tombstones = true;
+            instructions[w++] = {OpCode::Negate, 0};
+            a.constant = false;
+        } else {
+            instructions[w++] = ins;
+            a.constant = false;
+        }
+    }
+    instructions.resize(w);
+
+    if (tombstones) {
+        instructions.erase(std::remove_if(instructions.begin(),
+                                          instructions.end(),
+                                          [](const Instruction &ins) {
+                                              return ins.op == OpCode::Constant
+                                                     && ins.arg == Tombstone;
+                                          }),
+                           instructions.end());
+    }
+
+    // Уплотнение таблицы констант и пересчёт глубины стека
+    renumberConstants();
+    size_t depth = 0;
+    maxDepth = 0;
+    for (const Instruction &ins : instructions) {
+        if (ins.op == OpCode::Constant || ins.op == OpCode::Variable)
+            ++depth;
+        else
+            depth -= arity(ins.op) - 1;
+        maxDepth = std::max(maxDepth, depth);
+    }
+}
+
+void Program::renumberConstants()
+{
+    foldPool.clear();
+    for (Instruction &ins : instructions) {
+        if (ins.op == OpCode::Constant) {
+            foldPool.push_back(constants[ins.arg]);
+            ins.arg = static_cast<std::uint32_t>(foldPool.size() - 1);
+        }
+    }
+    constants.swap(foldPool);
+}
+
+std::uint32_t Program::internNode(OpCode op, std::uint64_t left, std::uint64_t right)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::uint64_t part : {static_cast<std::uint64_t>(op), left, right}) {
+        hash ^= part;
+        hash *= 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+    const size_t mask = nodeIndex.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        std::uint32_t entry = nodeIndex[i];
+        if (entry == 0) {
+            nodes.push_back({op, left, right, 1, 0});
+            nodeIndex[i] = static_cast<std::uint32_t>(nodes.size());
+            return static_cast<std::uint32_t>(nodes.size() - 1);
+        }
+        Node &node = nodes[entry - 1];
+        if (node.op == op && node.left == left && node.right == right) {
+            ++node.uses;
+            return entry - 1;
+        }
+    }
+}
+
+void Program::eliminateCommonSubexpressions()
+{
+    constexpr std::uint32_t NoTemp = UINT32_MAX;
+    const size_t count = instructions.size();
+    size_t tableSize = 16;
+    while (tableSize < count * 2)
+        tableSize *= 2;
+    nodeIndex.assign(tableSize, 0);
+    nodes.clear();
+    nodeOf.resize(count);
+    foldStack.clear();
+
+    // Проход 1: узел DAG для значения каждой команды
+    bool repeated = false;
+    for (size_t i = 0; i < count; ++i) {
+        const Instruction &ins = instructions[i];
+        std::uint64_t left = 0;
+        std::uint64_t right = 0;
+        if (ins.op == OpCode::Constant) {
+            std::memcpy(&left, &constants[ins.arg], sizeof(double));
+        } else if (ins.op == OpCode::Variable) {
+            left = ins.arg;
+        } else if (arity(ins.op) == 1) {
+            left = foldStack.back().node;
+            foldStack.pop_back();
+        } else {
+            right = foldStack.back().node;
+            foldStack.pop_back();
+            left = foldStack.back().node;
+            foldStack.pop_back();
+            // Сложение и умножение в IEEE коммутативны
+            if ((ins.op == OpCode::Add || ins.op == OpCode::Multiply) && left > right)
+                std::swap(left, right);
+        }
+        std::uint32_t node = internNode(ins.op, left, right);
+        bool leaf = ins.op == OpCode::Constant || ins.op == OpCode::Variable;
+        repeated = repeated || (!leaf && nodes[node].uses == 2);
+        nodeOf[i] = node;
+        foldStack.push_back({0, false, node});
+    }
+
+    // Проход 2: первое вхождение повторного узла сохраняется, остальные
+    // заменяются чтением. Код повторного вхождения сначала переписывается
+    // и затем отбрасывается: его внутренние общие узлы уже сохранены первым вхождением
+    if (repeated) {
+        for (Node &node : nodes)
+            node.temp = NoTemp;
+        rewritten.clear();
+        foldStack.clear();
+        std::uint32_t nextTemp = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const Instruction &ins = instructions[i];
+            size_t start = rewritten.size();
+            if (arity(ins.op) == 1) {
+                start = foldStack.back().start;
+                foldStack.pop_back();
+            } else if (ins.op != OpCode::Constant && ins.op != OpCode::Variable) {
+                foldStack.pop_back();
+                start = foldStack.back().start;
+                foldStack.pop_back();
+            }
+
+            Node &node = nodes[nodeOf[i]];
+            bool leaf = ins.op == OpCode::Constant || ins.op == OpCode::Variable;
+            if (leaf || node.uses < 2) {
+                rewritten.push_back(ins);
+            } else if (node.temp != NoTemp) {
+                rewritten.resize(start);
+                rewritten.push_back({OpCode::Load, node.temp});
+            } else {
+                rewritten.push_back(ins);
+                node.temp = nextTemp++;
+                rewritten.push_back({OpCode::Store, node.temp});
+            }
+            foldStack.push_back({start, false, nodeOf[i]});
+        }
+        instructions.swap(rewritten);
+        rewritten.clear();
+        temps = nextTemp;
+
+        size_t depth = 0;
+        maxDepth = 0;
+        for (const Instruction &ins : instructions) {
+            if (ins.op == OpCode::Constant || ins.op == OpCode::Variable || ins.op == OpCode::Load)
+                ++depth;
+            else if (ins.op != OpCode::Store)
+                depth -= arity(ins.op) - 1;
+            maxDepth = std::max(maxDepth, depth);
+        }
+    }
+
+    // Копия программы (например, в кэше) не тащит за собой рабочие данные прохода
+    nodes.clear();
+    nodeOf.clear();
+    foldStack.clear();
+}
+
+bool Program::sameCode(const Program &other) const
+{
+    if (instructions.size() != other.instructions.size()
+        || variables.list() != other.variables.list()
+        || constants.size() != other.constants.size() || wellFormed != other.wellFormed)
+        return false;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (instructions[i].op != other.instructions[i].op
+            || instructions[i].arg != other.instructions[i].arg)
+            return false;
+    }
+    return constants.empty()
+           || std::memcmp(constants.data(), other.constants.data(), constants.size() * sizeof(double))
+                  == 0;
+}
+
+std::string Program::listing() const
+{
+    std::string text;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        const Instruction &ins = instructions[i];
+        text += "  " + std::to_string(i) + ": ";
+        switch (ins.op) {
+        case OpCode::Constant: {
+            char buffer[32];
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), constants[ins.arg]);
+            text += "const " + std::string(buffer, res.ptr);
+            break;
+        }
+        case OpCode::Variable:
+            text += "load " + variables.name(ins.arg);
+            break;
+        case OpCode::BadNumber:
+            text += "bad " + badTokens[ins.arg];
+            break;
+        case OpCode::Negate:
+            text += "neg";
+            break;
+        case OpCode::Store:
+            text += "store $" + std::to_string(ins.arg);
+            break;
+        case OpCode::Load:
+            text += "load $" + std::to_string(ins.arg);
+            break;
+        default:
+            text += operatorName(ins.op);
+            break;
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+size_t Program::bind(const OperandMap &operands, double *slots) const
+{
+    size_t missing = 0;
+    for (size_t i = 0; i < variables.size(); ++i) {
+        const double *value = operands.find(variables.name(i));
+        if (!value) {
+            slots[i] = 0;
+            ++missing;
+        } else {
+            slots[i] = *value;
+        }
+    }
+    return missing;
+}
+
+EvalStatus Program::evaluate(const double *slots, double *stack, double &result) const
+{
+    double *top = stack;
+    double *temp = stack + maxDepth;
+    for (const Instruction &ins : instructions) {
+        switch (ins.op) {
+        case OpCode::Constant:
+            *top++ = constants[ins.arg];
+            break;
+        case OpCode::Variable:
+            *top++ = slots[ins.arg];
+            break;
+        case OpCode::Add:
+            --top;
+            top[-1] = top[-1] + top[0];
+            break;
+        case OpCode::Subtract:
+            --top;
+            top[-1] = top[-1] - top[0];
+            break;
+        case OpCode::Multiply:
+            --top;
+            top[-1] = top[-1] * top[0];
+            break;
+        case OpCode::Divide:
+            --top;
+            if (top[0] == 0)
+                return EvalStatus::DivisionByZero;
+            top[-1] = top[-1] / top[0];
+            break;
+        case OpCode::Negate:
+            top[-1] = 0.0 - top[-1];
+            break;
+        case OpCode::Store:
+            temp[ins.arg] = top[-1];
+            break;
+        case OpCode::Load:
+            *top++ = temp[ins.arg];
+            break;
+        case OpCode::BadNumber:
+            return EvalStatus::BadNumber;
+        default:
+            if (arity(ins.op) == 1) {
+                top[-1] = applyUnary(ins.op, top[-1]);
+            } else {
+                --top;
+                top[-1] = applyBinary(ins.op, top[-1], top[0]);
+            }
+            break;
+        }
+    }
+    result = stack[0];
+    return EvalStatus::Ok;
+}
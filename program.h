@@ -0,0 +1,133 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include "symbols.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class OpCode : std::uint8_t {
+    Constant, // arg - индекс в таблице констант
+    Variable, // arg - номер слота операнда
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    BadNumber, // arg - индекс некорректного числового токена
+    Negate,    // 0 - x одной командой (унарный минус)
+    Store,     // копирует вершину стека во временную ячейку arg (стек не меняется)
+    Load,      // кладёт на стек значение временной ячейки arg
+    // Остальные операции описаны в таблице operators.cpp
+    Power,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    Min,
+    Max,
+    Sqrt,
+    Abs,
+    Exp,
+    Log
+};
+
+struct Instruction
+{
+    OpCode op;
+    std::uint32_t arg;
+};
+
+enum class EvalStatus { Ok, DivisionByZero, StackUnderflow, BadNumber, Malformed };
+
+// Скомпилированная ОПЗ: плоский код, константы и слоты операндов.
+// Строится один раз и вычисляется для любого числа наборов операндов
+class Program
+{
+public:
+    void clear();
+    void compile(const std::string &rpn);
+    // Восстанавливает уже скомпилированную программу (например, из файла .bin).
+    // Проверяет только индексы и глубину стека; false - программа повреждена
+    bool assign(std::vector<Instruction> code,
+                std::vector<double> constantPool,
+                std::vector<std::string> variableNames);
+    // Свёртка константных подвыражений, "0 x -" -> Negate, x*1, x/1, x-0 -> x,
+    // затем исключение общих подвыражений. Результат любого вычисления совпадает
+    // с исходной программой (x+0 не упрощается: для x = -0 он даёт +0).
+    // exactOnly - сворачивать только операции, точные в double (для precise.h)
+    void optimize(bool exactOnly = false);
+    // Тот же код, те же константы (побитово) и те же слоты операндов
+    bool sameCode(const Program &other) const;
+    // Листинг кода по строке на команду, для отладочного вывода
+    std::string listing() const;
+
+    const std::vector<Instruction> &code() const { return instructions; }
+    double constant(std::uint32_t index) const { return constants[index]; }
+    size_t constantCount() const { return constants.size(); }
+    const std::string &badToken(std::uint32_t index) const { return badTokens[index]; }
+
+    size_t variableCount() const { return variables.size(); }
+    const std::string &variableName(size_t slot) const { return variables.name(slot); }
+    int findVariable(std::string_view name) const { return variables.find(name); }
+
+    size_t stackDepth() const { return maxDepth; }
+    size_t tempCount() const { return temps; }
+    // Память вычисления: стек и за ним временные ячейки общих подвыражений
+    size_t frameSize() const { return maxDepth + temps; }
+    bool isWellFormed() const { return wellFormed; }
+
+    // Заполняет slots значениями операндов; возвращает число неопределённых слотов
+    size_t bind(const OperandMap &operands, double *slots) const;
+
+    // Быстрый путь: только для isWellFormed() и полностью связанных слотов.
+    // stack должен вмещать frameSize() значений
+    EvalStatus evaluate(const double *slots, double *stack, double &result) const;
+
+private:
+    void foldConstants(bool exactOnly);
+    // Новая таблица констант: ячейки по порядку кода, у каждой команды Constant своя
+    void renumberConstants();
+    // Подвыражения хэшируются в узлы DAG (a+b и b+a - один узел). Узел,
+    // встреченный повторно, вычисляется один раз: после первого вхождения
+    // значение сохраняется командой Store, остальные вхождения заменяются на Load
+    void eliminateCommonSubexpressions();
+    std::uint32_t internNode(OpCode op, std::uint64_t left, std::uint64_t right);
+
+    // Значение на стеке во время прохода: начало его кода, константа ли это, узел DAG
+    struct FoldEntry
+    {
+        size_t start;
+        bool constant;
+        std::uint32_t node;
+    };
+
+    struct Node
+    {
+        OpCode op;
+        std::uint64_t left;  // Constant - биты значения, Variable - слот, иначе - узел
+        std::uint64_t right; // второй операнд двуместной операции
+        std::uint32_t uses;
+        std::uint32_t temp;
+    };
+
+    std::vector<Instruction> instructions;
+    std::vector<double> constants;
+    // Имена операндов, номер имени - слот; память индекса сохраняется между компиляциями
+    SymbolTable variables;
+    std::vector<std::string> badTokens;
+    // Рабочая память проходов оптимизации; сохраняется между компиляциями
+    std::vector<FoldEntry> foldStack;
+    std::vector<double> foldPool;
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> nodeIndex;
+    std::vector<std::uint32_t> nodeOf;
+    std::vector<Instruction> rewritten;
+    size_t maxDepth = 0;
+    size_t temps = 0;
+    bool wellFormed = false;
+};
+
+#endif // PROGRAM_H
@@ -0,0 +1,378 @@
+#include "server.h"
+#include "engine.h"
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Байтов за одно чтение: пачка запросов обычно приходит целиком
+constexpr size_t ReadSize = 64 * 1024;
+
+#ifndef _WIN32
+// Запись в сокет отключившегося клиента не должна завершать сервер сигналом SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+constexpr int SendFlags = 0;
+#endif
+
+bool setNonBlocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Запись целиком в блокирующий или неблокирующий дескриптор
+bool writeAll(int fd, std::string_view data)
+{
+    while (!data.empty()) {
+        const ssize_t n = write(fd, data.data(), data.size());
+        if (n > 0) {
+            data.remove_prefix(static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd ready{fd, POLLOUT, 0};
+            poll(&ready, 1, -1);
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+// Удаляется только сокет: путь, по ошибке указывающий на обычный файл, не трогаем
+bool removeSocket(const std::string &path)
+{
+    struct stat info;
+    if (lstat(path.c_str(), &info) != 0)
+        return errno == ENOENT;
+    return S_ISSOCK(info.st_mode) && unlink(path.c_str()) == 0;
+}
+#endif
+
+} // namespace
+
+EvalServer::EvalServer(Engine &engine)
+    : engine(engine)
+{}
+
+EvalServer::~EvalServer()
+{
+#ifndef _WIN32
+    for (int fd : wake) {
+        if (fd >= 0)
+            close(fd);
+    }
+#endif
+}
+
+void EvalServer::setPrecision(Precision precision)
+{
+    this->precision = precision;
+    engine.setPrecision(precision);
+}
+
+void EvalServer::handle(std::string_view request, std::string &response)
+{
+    ++requests;
+    double value = 0;
+    const bool ok = engine.processText(request, &value);
+    auto format = [this](double value, double bound) {
+        return precision == Precision::Double ? Engine::formatDouble(value)
+                                              : Engine::formatPrecise(value, bound);
+    };
+
+    const ExpressionSet &set = engine.expressions();
+    if (set.empty() && ok) {
+        response += "OK ";
+        response += format(value, engine.errorBound());
+        response += '\n';
+    }
+    for (size_t i = 0; i < set.size(); ++i) {
+        const ExpressionResult &result = set.result(i);
+        if (result.status != EvalStatus::Ok)
+            continue;
+        response += "OK ";
+        response += set.name(i);
+        response += ": ";
+        response += format(result.value, result.bound);
+        response += '\n';
+    }
+
+    // Каждая ошибка - своей строкой; префикс сообщения Engine ("ERROR: " или "ОШИБКА: ")
+    // заменяется словом ERROR протокола
+    if (!ok) {
+        ++failures;
+        std::string_view errors = engine.errors();
+        if (errors.empty())
+            response += "ERROR\n";
+        while (!errors.empty()) {
+            const size_t end = errors.find('\n');
+            std::string_view line = errors.substr(0, end);
+            errors.remove_prefix(end == std::string_view::npos ? errors.size() : end + 1);
+            for (std::string_view prefix : {"ERROR: ", "ОШИБКА: "}) {
+                if (line.substr(0, prefix.size()) == prefix)
+                    line.remove_prefix(prefix.size());
+            }
+            response += "ERROR ";
+            response += line;
+            response += '\n';
+        }
+    }
+    response += ".\n";
+}
+
+void EvalServer::consume(Connection &connection, bool last)
+{
+    const std::string_view input = connection.input;
+    size_t start = 0;
+    size_t pos = connection.scanned;
+    for (size_t end; (end = input.find('\n', pos)) != std::string_view::npos; pos = end + 1) {
+        std::string_view line = input.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line == ".") {
+            handle(input.substr(start, pos - start), connection.output);
+            start = end + 1;
+        }
+    }
+    if (last && start < input.size()) {
+        handle(input.substr(start), connection.output);
+        start = pos = input.size();
+    }
+    connection.input.erase(0, start);
+    connection.scanned = pos - start;
+
+    if (connection.input.size() > MaxRequestSize) {
+        ++requests;
+        ++failures;
+        connection.output += "ERROR Запрос длиннее " + std::to_string(MaxRequestSize)
+                             + " байт\n.\n";
+        connection.input.clear();
+        connection.scanned = 0;
+        connection.closing = true;
+    }
+}
+
+#ifdef _WIN32
+
+bool EvalServer::serveStream(int, int, std::string &error)
+{
+    error = "ERROR: Сервер на этой платформе не поддерживается";
+    return false;
+}
+
+bool EvalServer::serveSocket(const std::string &, std::string &error)
+{
+    error = "ERROR: Сервер на этой платформе не поддерживается";
+    return false;
+}
+
+void EvalServer::stop()
+{
+    stopping = true;
+}
+
+#else
+
+void EvalServer::stop()
+{
+    stopping = true;
+    if (wake[1] >= 0) {
+        const char byte = 0;
+        [[maybe_unused]] ssize_t n = write(wake[1], &byte, 1);
+    }
+}
+
+bool EvalServer::openWake(std::string &error)
+{
+    if (wake[0] >= 0)
+        return true;
+    if (pipe(wake) != 0 || !setNonBlocking(wake[0]) || !setNonBlocking(wake[1])) {
+        error = "ERROR: Не удалось создать канал остановки сервера";
+        return false;
+    }
+    return true;
+}
+
+bool EvalServer::flush(Connection &connection)
+{
+    while (connection.written < connection.output.size()) {
+        const ssize_t n = send(connection.fd,
+                               connection.output.data() + connection.written,
+                               connection.output.size() - connection.written,
+                               SendFlags);
+        if (n > 0) {
+            connection.written += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    connection.output.clear();
+    connection.written = 0;
+    return true;
+}
+
+bool EvalServer::serveStream(int in, int out, std::string &error)
+{
+    if (!openWake(error))
+        return false;
+    Connection connection;
+    connection.fd = in;
+    std::vector<char> buffer(ReadSize);
+    while (!stopping) {
+        pollfd fds[2] = {{in, POLLIN, 0}, {wake[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            error = "ERROR: Ошибка ожидания запросов";
+            return false;
+        }
+        if (fds[1].revents != 0)
+            break;
+
+        const ssize_t n = read(in, buffer.data(), buffer.size());
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            error = "ERROR: Ошибка чтения запросов";
+            return false;
+        }
+        connection.input.append(buffer.data(), static_cast<size_t>(n));
+        consume(connection, n == 0);
+        if (!writeAll(out, connection.output)) {
+            error = "ERROR: Ошибка записи ответов";
+            return false;
+        }
+        connection.output.clear();
+        if (connection.closing) {
+            error = "ERROR: Запрос длиннее " + std::to_string(MaxRequestSize) + " байт";
+            return false;
+        }
+        if (n == 0)
+            break;
+    }
+    return true;
+}
+
+
+bool EvalServer::serveSocket(const std::string &path, std::string &error)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        error = "ERROR: Слишком длинный путь сокета: " + path;
+        return false;
+    }
+    std::copy(path.begin(), path.end(), address.sun_path);
+    if (!openWake(error))
+        return false;
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        error = "ERROR: Не удалось создать сокет";
+        return false;
+    }
+    if (!removeSocket(path)) {
+        error = "ERROR: Путь занят файлом, который не является сокетом: " + path;
+        close(listener);
+        return false;
+    }
+    // Подключаться может только владелец процесса
+    const mode_t mask = umask(077);
+    const bool bound = bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address))
+                       == 0;
+    umask(mask);
+    if (!bound || listen(listener, SOMAXCONN) != 0 || !setNonBlocking(listener)) {
+        error = "ERROR: Не удалось открыть сокет: " + path;
+        close(listener);
+        return false;
+    }
+
+    std::vector<Connection> clients;
+    std::vector<pollfd> fds;
+    std::vector<char> buffer(ReadSize);
+    bool ok = true;
+    while (!stopping) {
+        fds.clear();
+        fds.push_back({listener, POLLIN, 0});
+        fds.push_back({wake[0], POLLIN, 0});
+        // Клиент, не забирающий ответы, не читается: иначе его ответы копятся без предела
+        auto reading = [](const Connection &client) {
+            return !client.closing && client.output.size() - client.written <= OutputHighWater;
+        };
+        for (const Connection &client : clients) {
+            short events = reading(client) ? POLLIN : 0;
+            if (!client.output.empty())
+                events |= POLLOUT;
+            fds.push_back({client.fd, events, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            error = "ERROR: Ошибка ожидания запросов";
+            ok = false;
+            break;
+        }
+        if (fds[1].revents != 0)
+            break;
+
+        // Сначала существующие клиенты: индексы fds соответствуют clients
+        for (size_t i = 0; i < clients.size(); ++i) {
+            Connection &client = clients[i];
+            const short revents = fds[i + 2].revents;
+            if (reading(client) && (revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+                const ssize_t n = read(client.fd, buffer.data(), buffer.size());
+                if (n > 0) {
+                    client.input.append(buffer.data(), static_cast<size_t>(n));
+                    consume(client, false);
+                } else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+                    consume(client, true);
+                    client.closing = true;
+                }
+            }
+            if (!flush(client) || (client.closing && client.output.empty())) {
+                close(client.fd);
+                client.fd = -1;
+            }
+        }
+        clients.erase(std::remove_if(clients.begin(),
+                                     clients.end(),
+                                     [](const Connection &client) { return client.fd < 0; }),
+                      clients.end());
+
+        if (fds[0].revents & POLLIN) {
+            for (int fd; (fd = accept(listener, nullptr, nullptr)) >= 0;) {
+                if (!setNonBlocking(fd)) {
+                    close(fd);
+                    continue;
+                }
+                clients.emplace_back();
+                clients.back().fd = fd;
+            }
+        }
+    }
+
+    for (const Connection &client : clients)
+        close(client.fd);
+    close(listener);
+    removeSocket(path);
+    return ok;
+}
+
+#endif
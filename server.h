@@ -0,0 +1,88 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "precise.h"
+#include <atomic>
+#include <string>
+#include <string_view>
+
+class Engine;
+
+// Сервер вычислений: долгоживущий процесс с прогретым Engine. Скомпилированные выражения
+// остаются в кэше программ Engine, поэтому повторный запрос с тем же выражением не
+// проходит разбор в ОПЗ заново.
+// Протокол построчный. Запрос - содержимое файла выражения (одно выражение или несколько
+// именованных, затем строки операндов) и строка ".". Ответ - строки "OK значение",
+// "ERROR сообщение" для каждой ошибки и строка ".". У нескольких выражений сначала идут
+// строки "OK имя: значение" вычисленных, затем ошибки с именем выражения:
+//     OK f: 1
+//     ERROR h: Незакрытая круглая скобка (      - ошибка разбора, по мере чтения
+//     ERROR g: деление на ноль                  - ошибки вычисления, по порядку выражений
+//     ERROR h: выражение содержит ошибки
+//     .
+// Без имени - только ошибки файла целиком (повторное имя выражения, строки операндов).
+// Запросы можно слать пачками, не дожидаясь ответов: всё, что пришло одним чтением,
+// вычисляется подряд, и ответы уходят одной записью
+class EvalServer
+{
+public:
+    // Наибольший запрос: на более длинный отвечает ошибкой и закрывает соединение
+    static constexpr size_t MaxRequestSize = 64 * 1024 * 1024;
+    // Пока неотправленных ответов больше, новые запросы соединения не читаются
+    static constexpr size_t OutputHighWater = 1024 * 1024;
+
+    // Engine настраивает вызывающий (кэш, метрики, пул); приёмник сообщений не нужен
+    explicit EvalServer(Engine &engine);
+    ~EvalServer();
+
+    EvalServer(const EvalServer &) = delete;
+    EvalServer &operator=(const EvalServer &) = delete;
+
+    // Формат результата; Engine получает ту же точность
+    void setPrecision(Precision precision);
+
+    // Один запрос без завершающей строки "."; ответ дописывается в response
+    void handle(std::string_view request, std::string &response);
+
+    // Дескрипторы потока (стандартный ввод и вывод): до конца ввода или stop().
+    // Запрос без "." в конце ввода тоже вычисляется
+    bool serveStream(int in, int out, std::string &error);
+    // Сокет Unix по пути path с доступом только для владельца. Старый сокет заменяется,
+    // другой файл по этому пути - ошибка. Клиенты обслуживаются по очереди в одном
+    // потоке через poll(); работает до stop()
+    bool serveSocket(const std::string &path, std::string &error);
+    // Можно вызывать из другого потока и из обработчика сигнала
+    void stop();
+
+    size_t requestCount() const { return requests; }
+    size_t failureCount() const { return failures; }
+
+private:
+    // Соединение: принятые, но ещё не разобранные байты и неотправленные ответы
+    struct Connection
+    {
+        int fd = -1;
+        std::string input;
+        size_t scanned = 0; // input до этого места уже просмотрен, запроса в нём нет
+        std::string output;
+        size_t written = 0;
+        bool closing = false; // ввод закончился: закрыть после отправки ответов
+    };
+
+    // Вычисляет все полные запросы из input и убирает их оттуда.
+    // last - ввод закончился, остаток тоже запрос. Незаконченный запрос длиннее
+    // MaxRequestSize получает ответ с ошибкой, и соединение закрывается (closing)
+    void consume(Connection &connection, bool last);
+    // Неблокирующая отправка ответов; false - соединение разорвано
+    bool flush(Connection &connection);
+    bool openWake(std::string &error);
+
+    Engine &engine;
+    Precision precision = Precision::Double;
+    std::atomic<bool> stopping{false};
+    int wake[2] = {-1, -1}; // stop() пишет байт, чтобы прервать ожидание poll()
+    size_t requests = 0;
+    size_t failures = 0;
+};
+
+#endif // SERVER_H
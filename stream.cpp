@@ -0,0 +1,68 @@
+#include "stream.h"
+#include <istream>
+#include <ostream>
+
+StreamEvaluator::StreamEvaluator(const Program &program, const OperandMap &scalars)
+    : program(program)
+    , scalars(scalars)
+{}
+
+bool StreamEvaluator::run(std::istream &in, std::ostream &out, std::string &error)
+{
+    rows = 0;
+    failures = 0;
+    if (kernels)
+        evaluator.setKernels(*kernels);
+
+    CsvReader reader(in);
+    std::vector<std::string> header;
+    if (!reader.readHeader(header, error))
+        return false;
+    chunk.setColumns(header);
+
+    // Проверяем привязку операндов до первой записи, а не на первой порции
+    if (!evaluator.prepare(program, chunk, scalars, error))
+        return false;
+
+    out << "result\n";
+    std::vector<double> values;
+    while (reader.readRow(values, error)) {
+        chunk.appendRow(values);
+        if (chunk.rowCount() >= chunkRows && !flush(out, error))
+            return false;
+    }
+
+    // Ошибка чтения не отменяет уже прочитанные записи: их результат выводится
+    std::string readError = std::move(error);
+    error.clear();
+    if (!flush(out, error))
+        return false;
+    error = std::move(readError);
+    return error.empty();
+}
+
+bool StreamEvaluator::flush(std::ostream &out, std::string &error)
+{
+    if (chunk.rowCount() == 0)
+        return true;
+
+    // Столбцы порции могли переехать в памяти, поэтому указатели обновляются каждый раз
+    if (!evaluator.prepare(program, chunk, scalars, error))
+        return false;
+    if (pool)
+        evaluator.evaluateAll(result, *pool);
+    else
+        evaluator.evaluateAll(result);
+
+    writeResultRows(out, result.values.data(), result.failed.data(), chunk.rowCount());
+    out.flush();
+    if (!out) {
+        error = "ERROR: Ошибка записи результата";
+        return false;
+    }
+
+    rows += chunk.rowCount();
+    failures += result.failures;
+    chunk.clearRows();
+    return true;
+}
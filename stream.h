@@ -0,0 +1,45 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "columns.h"
+#include <iosfwd>
+#include <string>
+
+// Потоковое вычисление: записи операндов (CSV с заголовком, как у ColumnTable)
+// читаются порциями по chunkRows строк, результат каждой порции сразу выводится.
+// Память ограничена размером порции и не зависит от объёма ввода
+class StreamEvaluator
+{
+public:
+    static constexpr size_t DefaultChunkRows = ColumnEvaluator::TaskRows;
+
+    StreamEvaluator(const Program &program, const OperandMap &scalars);
+
+    // 1 - вычислять и выводить каждую запись сразу после чтения
+    void setChunkRows(size_t rows) { chunkRows = rows == 0 ? 1 : rows; }
+    void setKernels(const KernelSet &kernels) { this->kernels = &kernels; }
+    void setPool(ThreadPool *pool) { this->pool = pool; }
+    void setNative(const NativeProgram *native) { evaluator.setNative(native); }
+
+    bool run(std::istream &in, std::ostream &out, std::string &error);
+
+    size_t rowCount() const { return rows; }
+    size_t failureCount() const { return failures; }
+
+private:
+    bool flush(std::ostream &out, std::string &error);
+
+    const Program &program;
+    const OperandMap &scalars;
+    const KernelSet *kernels = nullptr;
+    ThreadPool *pool = nullptr;
+    size_t chunkRows = DefaultChunkRows;
+
+    ColumnTable chunk;
+    ColumnEvaluator evaluator;
+    ColumnResult result;
+    size_t rows = 0;
+    size_t failures = 0;
+};
+
+#endif // STREAM_H
@@ -0,0 +1,117 @@
+#include "symbols.h"
+#include <algorithm>
+
+namespace {
+
+std::uint32_t hashName(std::string_view name)
+{
+    std::uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+} // namespace
+
+void SymbolTable::clear()
+{
+    // Очищаются только занятые ячейки: после большого файла индекс остаётся большим,
+    // и обнулять его целиком на каждом маленьком выражении было бы дорого
+    if (names.size() * 8 < index.size()) {
+        const size_t mask = index.size() - 1;
+        for (size_t id = 0; id < hashes.size(); ++id) {
+            size_t i = hashes[id] & mask;
+            while (index[i] != id + 1)
+                i = (i + 1) & mask;
+            index[i] = 0;
+        }
+    } else {
+        std::fill(index.begin(), index.end(), 0);
+    }
+    names.clear();
+    hashes.clear();
+}
+
+void SymbolTable::reserve(size_t count)
+{
+    if (count * 2 > index.size())
+        rebuild(count * 2);
+}
+
+void SymbolTable::rebuild(size_t capacity)
+{
+    size_t size = 16;
+    while (size < capacity)
+        size *= 2;
+    index.assign(size, 0);
+    const size_t mask = size - 1;
+    for (size_t id = 0; id < hashes.size(); ++id) {
+        size_t i = hashes[id] & mask;
+        while (index[i] != 0)
+            i = (i + 1) & mask;
+        index[i] = static_cast<std::uint32_t>(id + 1);
+    }
+}
+
+std::uint32_t SymbolTable::intern(std::string_view name)
+{
+    if ((names.size() + 1) * 2 > index.size())
+        rebuild((names.size() + 1) * 2);
+    const std::uint32_t hash = hashName(name);
+    const size_t mask = index.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        std::uint32_t entry = index[i];
+        if (entry == 0) {
+            names.emplace_back(name);
+            hashes.push_back(hash);
+            index[i] = static_cast<std::uint32_t>(names.size());
+            return static_cast<std::uint32_t>(names.size() - 1);
+        }
+        if (hashes[entry - 1] == hash && names[entry - 1] == name)
+            return entry - 1;
+    }
+}
+
+int SymbolTable::find(std::string_view name) const
+{
+    if (names.empty())
+        return -1;
+    const std::uint32_t hash = hashName(name);
+    const size_t mask = index.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        std::uint32_t entry = index[i];
+        if (entry == 0)
+            return -1;
+        if (hashes[entry - 1] == hash && names[entry - 1] == name)
+            return static_cast<int>(entry - 1);
+    }
+}
+
+void OperandMap::clear()
+{
+    symbols.clear();
+    values.clear();
+}
+
+void OperandMap::reserve(size_t operands)
+{
+    symbols.reserve(operands);
+    values.reserve(operands);
+}
+
+void OperandMap::set(std::string_view name, double value)
+{
+    std::uint32_t id = symbols.intern(name);
+    if (id == values.size())
+        values.push_back(value);
+    else
+        values[id] = value;
+}
+
+const double *OperandMap::find(std::string_view name) const
+{
+    int id = symbols.find(name);
+    return id < 0 ? nullptr : &values[id];
+}
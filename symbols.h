@@ -0,0 +1,60 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Интернированные имена: каждое различное имя получает номер по порядку первого
+// появления. Индекс - открытая адресация с линейным пробированием, в ячейке номер + 1
+// (0 - пусто); при заполнении наполовину таблица растёт вдвое по сохранённым хэшам,
+// строки заново не хэшируются. Память сохраняется между clear()
+class SymbolTable
+{
+public:
+    void clear();
+    // Индекс без перестроений для names имён
+    void reserve(size_t names);
+
+    // Номер имени; новое имя получает следующий номер
+    std::uint32_t intern(std::string_view name);
+    // Номер имени или -1
+    int find(std::string_view name) const;
+
+    size_t size() const { return names.size(); }
+    bool empty() const { return names.empty(); }
+    const std::string &name(size_t id) const { return names[id]; }
+    const std::vector<std::string> &list() const { return names; }
+
+private:
+    void rebuild(size_t capacity);
+
+    std::vector<std::string> names;
+    std::vector<std::uint32_t> hashes;
+    std::vector<std::uint32_t> index;
+};
+
+// Значения операндов по интернированным именам: поиск за O(1) вместо обхода дерева
+// строк. Повторное имя перезаписывает значение; обход - в порядке первого появления
+class OperandMap
+{
+public:
+    void clear();
+    void reserve(size_t operands);
+
+    void set(std::string_view name, double value);
+    // Значение операнда или nullptr
+    const double *find(std::string_view name) const;
+
+    size_t size() const { return symbols.size(); }
+    bool empty() const { return symbols.empty(); }
+    const std::string &name(size_t id) const { return symbols.name(id); }
+    double value(size_t id) const { return values[id]; }
+
+private:
+    SymbolTable symbols;
+    std::vector<double> values;
+};
+
+#endif // SYMBOLS_H
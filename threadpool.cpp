@@ -0,0 +1,118 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    if (threads == 0)
+        threads = hardwareThreads();
+    for (size_t i = 0; i < threads; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 1; i < threads; ++i)
+        this->threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+size_t ThreadPool::hardwareThreads()
+{
+    unsigned count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+void ThreadPool::run(size_t count, const Task &task)
+{
+    if (count == 0)
+        return;
+
+    // Задачи раздаются непрерывными диапазонами: соседние блоки строк
+    // достаются одному исполнителю, пока его не начнут обкрадывать
+    const size_t workers = queues.size();
+    for (size_t w = 0; w < workers; ++w) {
+        std::lock_guard<std::mutex> lock(queues[w]->mutex);
+        for (size_t i = count * w / workers; i < count * (w + 1) / workers; ++i)
+            queues[w]->items.push_back(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        current = &task;
+        remaining = count;
+        active = workers;
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    --active;
+    done.wait(lock, [this] { return remaining == 0 && active == 0; });
+    current = nullptr;
+}
+
+void ThreadPool::workerLoop(size_t worker)
+{
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        drain(worker);
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--active == 0)
+            done.notify_all();
+    }
+}
+
+void ThreadPool::drain(size_t worker)
+{
+    size_t index = 0;
+    size_t finished = 0;
+    while (popLocal(worker, index) || steal(worker, index)) {
+        (*current)(index, worker);
+        ++finished;
+    }
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    remaining -= finished;
+}
+
+bool ThreadPool::popLocal(size_t worker, size_t &index)
+{
+    Queue &queue = *queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty())
+        return false;
+    index = queue.items.back();
+    queue.items.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t worker, size_t &index)
+{
+    const size_t workers = queues.size();
+    for (size_t offset = 1; offset < workers; ++offset) {
+        Queue &victim = *queues[(worker + offset) % workers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty()) {
+            index = victim.items.front();
+            victim.items.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,61 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с кражей работы: у каждого исполнителя своя очередь задач,
+// свои задачи он берёт с конца, а опустевший исполнитель забирает чужие с начала.
+// Вызывающий поток участвует в работе как исполнитель с номером 0
+class ThreadPool
+{
+public:
+    // task(index, worker): index - номер задачи, worker - номер исполнителя
+    // в диапазоне [0, threadCount()), удобен для рабочей памяти на поток
+    using Task = std::function<void(size_t index, size_t worker)>;
+
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t threadCount() const { return queues.size(); }
+
+    // Выполняет задачи 0..count-1 и возвращает управление, когда все завершены
+    void run(size_t count, const Task &task);
+
+    static size_t hardwareThreads();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    void workerLoop(size_t worker);
+    void drain(size_t worker);
+    bool popLocal(size_t worker, size_t &index);
+    bool steal(size_t worker, size_t &index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const Task *current = nullptr;
+    size_t generation = 0;
+    size_t remaining = 0;
+    size_t active = 0;
+    bool stopping = false;
+};
+
+#endif // THREADPOOL_H
@@ -10,11 +10,18 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Общее вычислительное ядро (консольная цель nature_eval - в nature_eval.pro)
+include(engine.pri)
+
 SOURCES += \
+    evalworker.cpp \
+    logmodel.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    evalworker.h \
+    logmodel.h \
     mainwindow.h
 
 FORMS += \